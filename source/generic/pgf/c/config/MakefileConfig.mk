@@ -34,6 +34,11 @@ LINKSHAREDLUA=
 # Architecture flags:
 ARCHFLAGS=
 
+# Flags for compiling and linking with POSIX threads. To build
+# without threads, leave this empty and add -DPGFGD_NO_THREADS to
+# MYCFLAGS:
+THREADFLAGS=-pthread
+
 # The to-be-used compiler
 CC=gcc
 
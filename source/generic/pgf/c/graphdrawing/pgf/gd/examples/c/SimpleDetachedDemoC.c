@@ -0,0 +1,60 @@
+#include <pgf/gd/interface/c/InterfaceFromC.h>
+#include <math.h>
+
+// Places the vertices on a circle of radius 1cm like the fast simple
+// demo layout and routes every other edge through the center of the
+// circle. The other edges are not touched, so they are drawn as
+// straight lines between their anchors. The positions are written to
+// the x and y arrays instead of the pos fields, the paths start and
+// end at the anchors of the new positions.
+static void fast_detached_hello_world (pgfgd_SyntacticDigraph* graph, void* unused) {
+  double angle  = 6.28318530718 / graph->vertices.length;
+  double radius = 28.45276;
+
+  int i;
+  (void) unused;
+
+  for (i = 0; i < graph->vertices.length; i++) {
+    graph->x[i] = cos(angle*i) * radius;
+    graph->y[i] = sin(angle*i) * radius;
+  }
+
+  for (i = 0; i < graph->syntactic_edges.length; i += 2) {
+    pgfgd_Edge* e = graph->syntactic_edges.array[i];
+    pgfgd_path_append_moveto_tail (e);
+    pgfgd_path_append_lineto      (e, 0, 0);
+    pgfgd_path_append_lineto_head (e);
+  }
+}
+
+int luaopen_pgf_gd_examples_c_SimpleDetachedDemoC (struct lua_State *state) {
+  pgfgd_Declaration* d;
+
+  // The algorithm, running detached from Lua
+  d = pgfgd_new_key ("fast simple detached demo layout");
+  pgfgd_key_summary          (d, "A version of the hello world of graph drawing that runs detached from Lua.");
+  pgfgd_key_algorithm        (d, fast_detached_hello_world, 0);
+  pgfgd_key_documentation    (d,
+    "Arranges the nodes of a graph in a circle like the |fast simple \
+     demo layout| and routes every other edge through the center of \
+     the circle. The drawing is not rotated afterwards. The algorithm \
+     does not access the Lua layer while it runs, so when the \
+     |parallel components| key is set, it is run on all components of \
+     a graph at once.");
+  pgfgd_key_add_precondition (d, "connected");
+  pgfgd_key_add_postcondition(d, "fixed");
+  pgfgd_key_detached         (d);
+  pgfgd_declare              (state, d);
+  pgfgd_free_key             (d);
+
+  // The same algorithm, running attached
+  d = pgfgd_new_key ("fast simple attached demo layout");
+  pgfgd_key_summary          (d, "Like the fast simple detached demo layout, but runs attached to Lua.");
+  pgfgd_key_algorithm        (d, fast_detached_hello_world, 0);
+  pgfgd_key_add_precondition (d, "connected");
+  pgfgd_key_add_postcondition(d, "fixed");
+  pgfgd_declare              (state, d);
+  pgfgd_free_key             (d);
+
+  return 0;
+}
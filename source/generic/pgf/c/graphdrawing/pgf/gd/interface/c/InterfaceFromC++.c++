@@ -9,25 +9,80 @@ extern "C" {
   
 // Lua stuff:
 #include <lauxlib.h>
-  
+
 }
 
+// Threads, see InterfaceFromC.c:
+#if !defined(PGFGD_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#include <unistd.h>
+#if defined(_POSIX_THREADS) && _POSIX_THREADS > 0
+#define PGFGD_THREADS
+#include <pthread.h>
+#endif
+#endif
+
+// C++ stuff:
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+
 
 namespace {
 
+  // Serializes the runs of runners that cannot be cloned. Without
+  // threads, pgfgd_parallel_for runs everything one after the other
+  // anyway:
+#ifdef PGFGD_THREADS
+  pthread_mutex_t shared_runner_lock = PTHREAD_MUTEX_INITIALIZER;
+#define lock_shared_runner()   pthread_mutex_lock(&shared_runner_lock)
+#define unlock_shared_runner() pthread_mutex_unlock(&shared_runner_lock)
+#else
+#define lock_shared_runner()
+#define unlock_shared_runner()
+#endif
+
+  struct runner_instance {
+    scripting::runner* shared;
+    scripting::runner* algo;
+
+    runner_instance (scripting::runner* r) : shared(r), algo(r->clone()) {
+      if (!algo) {
+	lock_shared_runner();
+	algo = shared;
+      }
+    }
+    
+    ~runner_instance () {
+      if (algo == shared)
+	unlock_shared_runner();
+      else
+	delete algo;
+    }
+  };
+  
   void cpp_caller(pgfgd_SyntacticDigraph* g, void* f)
   {
     using namespace scripting;
     
-    run_parameters p;
-    p.syntactic_digraph = g;
+    run_parameters p (g);
     
-    runner* algo = static_cast<runner*> (f);
+    runner_instance instance (static_cast<runner*> (f));
+    runner* algo = instance.algo;
     
     algo->prepare(&p);
+
+    double t0 = pgfgd_clock();
     algo->bridge();
+    double t1 = pgfgd_clock();
     algo->run();
+    double t2 = pgfgd_clock();
     algo->unbridge();
+    double t3 = pgfgd_clock();
+
+    pgfgd_add_phase_time(g, "bridge", t1 - t0);
+    pgfgd_add_phase_time(g, "run", t2 - t1);
+    pgfgd_add_phase_time(g, "unbridge", t3 - t2);
   }
 
 }
@@ -121,6 +176,26 @@ namespace scripting {
     return *this;
   }
 
+  const key& key::snapshot_option (const char* x) const {
+    pgfgd_key_add_snapshot_option(d, x);
+    return *this;
+  }
+
+  const key& key::detached () const {
+    pgfgd_key_detached(d);
+    return *this;
+  }
+
+  const key& key::snapshot_digraph (const char* x) const {
+    pgfgd_key_add_snapshot_digraph(d, x);
+    return *this;
+  }
+
+  const key& key::snapshot_anchor (const char* x) const {
+    pgfgd_key_add_snapshot_anchor(d, x);
+    return *this;
+  }
+
   const key& key::algorithm (runner* a) const {
     pgfgd_key_algorithm(d, cpp_caller, static_cast<void*>(a));
     return *this;
@@ -146,14 +221,36 @@ namespace scripting {
 
   // The run_parameters class
 
+  // The options looked up so far, by interned key:
+  class run_parameters::option_cache {
+  public:
+    std::map<pgfgd_key_ref, pgfgd_Option> options;
+  };
+  
+  run_parameters::run_parameters (pgfgd_SyntacticDigraph* g)
+    : syntactic_digraph (g), cache (new option_cache) {}
+  
+  run_parameters::~run_parameters () { delete cache; }
+
+  const pgfgd_Option& run_parameters::lookup (const char* k)
+  {
+    pgfgd_key_ref key = pgfgd_intern(k);
+    std::map<pgfgd_key_ref, pgfgd_Option>::iterator it = cache->options.find(key);
+    if (it == cache->options.end()) {
+      it = cache->options.insert(std::make_pair(key, pgfgd_Option())).first;
+      pgfgd_option_ref(syntactic_digraph->options, key, &it->second);
+    }
+    return it->second;
+  }
+  
   namespace {
     
     // Helpers:
     template <class T>
-    bool fromnumber (pgfgd_SyntacticDigraph* g, const char* k, T& t)
+    bool fromnumber (const pgfgd_Option& o, T& t)
     {
-      if (pgfgd_isnumber(g->options, k)) {
-	t = static_cast<T>(pgfgd_tonumber(g->options, k));
+      if (o.is_number) {
+	t = static_cast<T>(o.number);
 	return true;
       }
       return false;
@@ -163,8 +260,9 @@ namespace scripting {
   
   template <> bool run_parameters::option<bool> (const char* k, bool& t)
   {
-    if (pgfgd_isboolean(syntactic_digraph->options, k)) {
-      t = static_cast<bool>(pgfgd_toboolean(syntactic_digraph->options, k));
+    const pgfgd_Option& o = lookup(k);
+    if (o.is_boolean) {
+      t = static_cast<bool>(o.boolean);
       return true;
     }
     return false;
@@ -172,44 +270,59 @@ namespace scripting {
   
   template <> bool run_parameters::option<char*> (const char* k, char*& t)
   {
-    if (pgfgd_isstring(syntactic_digraph->options, k)) {
-      t = pgfgd_tostring(syntactic_digraph->options, k);
+    const pgfgd_Option& o = lookup(k);
+    if (o.is_string) {
+      t = static_cast<char*>(std::malloc(o.string_length+1));
+      std::memcpy(t, o.string, o.string_length+1);
       return true;
     }
     return false;
   }
   
   template <> bool run_parameters::option<short> (const char* k, short& t)
-  { return fromnumber<short> (syntactic_digraph, k, t); }
+  { return fromnumber<short> (lookup(k), t); }
   
   template <> bool run_parameters::option<unsigned short> (const char* k, unsigned short& t)
-  { return fromnumber<unsigned short> (syntactic_digraph, k, t); }
+  { return fromnumber<unsigned short> (lookup(k), t); }
   
   template <> bool run_parameters::option<int> (const char* k, int& t)
-  { return fromnumber<int> (syntactic_digraph, k, t); }
+  { return fromnumber<int> (lookup(k), t); }
   
   template <> bool run_parameters::option<unsigned int> (const char* k, unsigned int& t)
-  { return fromnumber<unsigned int> (syntactic_digraph, k, t); }
+  { return fromnumber<unsigned int> (lookup(k), t); }
   
   template <> bool run_parameters::option<long> (const char* k, long& t)
-  { return fromnumber<long> (syntactic_digraph, k, t); }
+  { return fromnumber<long> (lookup(k), t); }
   
   template <> bool run_parameters::option<unsigned long> (const char* k, unsigned long& t)
-  { return fromnumber<unsigned long> (syntactic_digraph, k, t); }
+  { return fromnumber<unsigned long> (lookup(k), t); }
   
   template <> bool run_parameters::option<float> (const char* k, float& t)
-  { return fromnumber<float> (syntactic_digraph, k, t); }
+  { return fromnumber<float> (lookup(k), t); }
   
   template <> bool run_parameters::option<double> (const char* k, double& t)
-  { return fromnumber<double> (syntactic_digraph, k, t); }
+  { return fromnumber<double> (lookup(k), t); }
   
   void* run_parameters::invoke_void_factory_for (const char* k)
   {
-    if (pgfgd_isuser (syntactic_digraph->options, k)) {
-      factory_base* user = static_cast<factory_base *>(pgfgd_touser (syntactic_digraph->options, k));
+    const pgfgd_Option& o = lookup(k);
+    if (o.is_user) {
+      factory_base* user = static_cast<factory_base *>(o.user);
       return user->make_void(this);
     }
     return 0;
   }
+
+  const char* run_parameters::string_view_for (const char* k, std::size_t& length)
+  {
+    const pgfgd_Option& o = lookup(k);
+    length = o.string_length;
+    return o.is_string ? o.string : 0;
+  }
+
+  void run_parameters::parallel_for_void (int n, void (*f) (int, int, void*), void* data)
+  {
+    pgfgd_parallel_for (syntactic_digraph, n, f, data);
+  }
   
 }
@@ -7,10 +7,17 @@
     in C++ for graph drawing in Lua.
 */
 
+#include <cstddef>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 
 struct lua_State;
 struct pgfgd_Declaration;
 struct pgfgd_SyntacticDigraph;
+struct pgfgd_Option;
 
 namespace scripting {
   
@@ -27,6 +34,12 @@ namespace scripting {
     virtual void bridge   () {}
     virtual void run      () = 0;
     virtual void unbridge () {}
+
+    // A detached algorithm may be run on several components at
+    // once. A runner that supports this returns a new copy of itself,
+    // which is used for a single run and then deleted. Runners
+    // returning 0 are run one at a time.
+    virtual runner* clone () const { return 0; }
     
     virtual ~runner  () {}
 
@@ -70,6 +83,10 @@ namespace scripting {
     const key& example          (const char*) const;
     const key& precondition     (const char*) const;
     const key& postcondition    (const char*) const;
+    const key& snapshot_option  (const char*) const;
+    const key& detached         () const;
+    const key& snapshot_digraph (const char*) const;
+    const key& snapshot_anchor  (const char*) const;
     const key& algorithm        (runner*) const;
 
   private:
@@ -129,10 +146,24 @@ namespace scripting {
   
 
   // Configuring a class
+  //
+  // The options of the graph are looked up only once per run: The
+  // first query of a key fetches its value and type, all further
+  // queries of the key, by the runner or by any factory it invokes,
+  // are answered from a cache. Since the cache is not thread safe,
+  // query all options before calling parallel_for.
+  //
+  // The object made by the factory stored in an option belongs to
+  // whoever asks for it: make hands it to the caller and
+  // configure_module to the setter, since OGDF's module setters take
+  // ownership of their modules.
 
   class run_parameters {
   public:
     
+    run_parameters (struct pgfgd_SyntacticDigraph*);
+    ~run_parameters ();
+    
     struct pgfgd_SyntacticDigraph* syntactic_digraph;
     
     template <class Layout, class T>
@@ -144,13 +175,50 @@ namespace scripting {
     template <class T> bool option        (const char*, T&);
     template <class T> T    option        (const char*);
     template <class T> bool option_is_set (const char*);
+
+#if __cplusplus >= 201703L
+    // Unlike option<char*>, this does not copy the string. The view
+    // stays valid until the algorithm returns.
+    bool option (const char*, std::string_view&);
+#endif
     
     template <class T> T*   make          (const char*);
 
+    // Configures l from all options described by Script::options,
+    // see option_descriptor below.
+    template <class Script, class Layout>
+    void configure_options (Layout& l);
+
+    // Calls f(i) for all i from 0 to n-1 using pgfgd_parallel_for,
+    // so f may be called from several threads at once.
+    template <class F> void parallel_for  (int n, F f);
+
   protected:
     void* invoke_void_factory_for (const char*);
+    const char* string_view_for (const char*, std::size_t&);
+    void parallel_for_void (int, void (*) (int, int, void*), void*);
+    const struct pgfgd_Option& lookup (const char*);
+
+  private:
+    class option_cache;
+    option_cache* cache;
+
+    run_parameters (const run_parameters&); // Not implemented.
+    run_parameters& operator = (const run_parameters&); // Not implemented.
   };
   
+#if __cplusplus >= 201703L
+  inline bool run_parameters::option (const char* k, std::string_view& t)
+  {
+    std::size_t length;
+    if (const char* s = string_view_for(k, length)) {
+      t = std::string_view(s, length);
+      return true;
+    }
+    return false;
+  }
+#endif
+  
   template <class T>
   T run_parameters::option (const char* k)
   {
@@ -184,6 +252,117 @@ namespace scripting {
   template <class T>
   T* run_parameters::make (const char* k) { return static_cast<T*>(invoke_void_factory_for(k)); }
 
+  
+  // Option descriptors
+  //
+  // Instead of declaring the options of a class in declare and
+  // reading them one at a time in run or make, a script can list
+  // each option once, together with the member function that sets
+  // it, in a static member function template:
+  //
+  //   template <class Visitor> static void options (Visitor& v) {
+  //     v (describe ("GEMLayout.numberOfRounds", &ogdf::GEMLayout::numberOfRounds)
+  //        .type ("number").initial ("20000"));
+  //     ...
+  //   }
+  //
+  // Calling declare_options<Script> in declare then declares the keys
+  // and calling parameters->configure_options<Script> in run or make
+  // sets all options on the layout object. Both loops are generated
+  // at compile time from the same list.
+
+  template <class Layout, class T>
+  struct option_descriptor {
+    const char* key_name;
+    void (Layout::*setter) (T);
+    const char* type_name;
+    const char* initial_value;
+    const char* alias_name;
+    const char* alias_function_string;
+
+    option_descriptor& type           (const char* x) { type_name = x; return *this; }
+    option_descriptor& initial        (const char* x) { initial_value = x; return *this; }
+    option_descriptor& alias          (const char* x) { alias_name = x; return *this; }
+    option_descriptor& alias_function (const char* x) { alias_function_string = x; return *this; }
+  };
+
+  template <class Layout, class T>
+  option_descriptor<Layout, T> describe (const char* k, void (Layout::*f) (T))
+  {
+    option_descriptor<Layout, T> d = { k, f, 0, 0, 0, 0 };
+    return d;
+  }
+  
+  class option_declarer {
+  public:
+    option_declarer (script s, const char* doc) : target(s), documentation(doc) {}
+
+    template <class Layout, class T>
+    void operator () (const option_descriptor<Layout, T>& d)
+    {
+      key k (d.key_name);
+      if (d.type_name)
+	k.type (d.type_name);
+      if (d.initial_value)
+	k.initial (d.initial_value);
+      if (d.alias_name)
+	k.alias (d.alias_name);
+      if (d.alias_function_string)
+	k.alias_function (d.alias_function_string);
+      if (documentation)
+	k.documentation_in (documentation);
+      target.declare (k);
+    }
+
+  private:
+    script      target;
+    const char* documentation;
+  };
+  
+  template <class Layout>
+  class option_configurer {
+  public:
+    option_configurer (run_parameters& p, Layout& l) : parameters(p), layout(l) {}
+
+    template <class T>
+    void operator () (const option_descriptor<Layout, T>& d)
+    {
+      parameters.configure_option (d.key_name, d.setter, layout);
+    }
+
+  private:
+    run_parameters& parameters;
+    Layout&         layout;
+  };
+
+  template <class Script>
+  void declare_options (script s, const char* documentation_in)
+  {
+    option_declarer d (s, documentation_in);
+    Script::options (d);
+  }
+  
+  template <class Script, class Layout>
+  void run_parameters::configure_options (Layout& l)
+  {
+    option_configurer<Layout> c (*this, l);
+    Script::options (c);
+  }
+
+  
+  template <class F>
+  void parallel_for_chunk (int from, int to, void* f)
+  {
+    for (int i = from; i < to; i++)
+      (*static_cast<F*>(f)) (i);
+  }
+  
+  template <class F>
+  void run_parameters::parallel_for (int n, F f)
+  {
+    parallel_for_void (n, parallel_for_chunk<F>, static_cast<void*>(&f));
+  }
+
 }
 
 
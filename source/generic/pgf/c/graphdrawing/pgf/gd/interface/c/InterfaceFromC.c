@@ -8,6 +8,19 @@
 // C stuff:
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+// Threads are used where POSIX threads are available, unless
+// PGFGD_NO_THREADS is defined. Without them, pgfgd_parallel_for runs
+// everything in the calling thread, so parallel components are
+// processed one after the other.
+#if !defined(PGFGD_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#include <unistd.h>
+#if defined(_POSIX_THREADS) && _POSIX_THREADS > 0
+#define PGFGD_THREADS
+#include <pthread.h>
+#endif
+#endif
 
 
 // Remove once Lua Link Bug is fixed:
@@ -19,6 +32,35 @@
 #define MIN_HASH_SIZE_FIX 1
 
 
+// These are the indices of the parameters during a run of the main
+// algorithm:  
+#define GRAPH_INDEX 1
+#define VERTICES_INDEX 2
+#define EDGES_INDEX 3
+#define ALGORITHM_INDEX 4
+
+// This is the index of the slots table of the ugraph, which maps the
+// vertices at VERTICES_INDEX back to their indices. It is pushed by
+// the C code and stays on the stack during the computations.
+#define SLOTS_INDEX 5
+
+// This is the index of a table whose keys are strings that have been
+// handed out to the C code without copying them. Storing them here
+// keeps them from being collected before the algorithm is done.
+#define STRING_ANCHOR_INDEX 6
+
+// These are the positions of different upvalues for the C closure of
+// a C algorithm.
+#define FUNCTION_UPVALUE 1
+#define USER_UPVALUE 2
+#define DIGRAPH_OBJECT_UPVALUE 3
+#define OPTION_KEYS_UPVALUE 4
+#define PATH_CLASS_UPVALUE 5
+#define COORDINATE_CLASS_UPVALUE 6
+#define DETACHED_INPUTS_UPVALUE 7
+
+
+
 
 // Help functions
 
@@ -31,12 +73,6 @@ static void set_field (lua_State* L, const char* what, const char* where)
 }
 
 
-static void init_vertex_array(pgfgd_Vertex_array* a, int count)
-{
-  a->length = count;
-  a->array  = (pgfgd_Vertex**) calloc(count, sizeof(pgfgd_Vertex*));
-}
-
 static void init_edge_array(pgfgd_Edge_array* a, int count)
 {
   a->length = count;
@@ -50,191 +86,747 @@ static void init_arcs_array(pgfgd_Arc_array* arcs, int length)
   arcs->heads  = (int*) calloc(length, sizeof(int));
 }
 
-static void init_path(pgfgd_Path* a, int count)
+// Arena allocation. Everything of the syntactic digraph that does
+// not change size during the run of an algorithm is allocated from an
+// arena, which is freed in one go once the results have been written
+// back. Memory returned by arena_alloc is zeroed.
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_CHUNK_SIZE 4096
+
+typedef struct pgfgd_ArenaChunk {
+  struct pgfgd_ArenaChunk* next;
+  size_t size;
+  size_t used;
+} pgfgd_ArenaChunk;
+
+#define ARENA_HEADER_SIZE ((sizeof(pgfgd_ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct pgfgd_Arena {
+  pgfgd_ArenaChunk* chunks;
+  size_t next_chunk_size;
+} pgfgd_Arena;
+
+static void arena_init(pgfgd_Arena* a, size_t size_hint)
 {
-  a->length      = count;
-  a->coordinates = (pgfgd_Coordinate*) calloc(count, sizeof(pgfgd_Coordinate));
-  a->strings     = (char**) calloc(count, sizeof(char*));
+  a->chunks = 0;
+  a->next_chunk_size = size_hint > ARENA_MIN_CHUNK_SIZE ? size_hint : ARENA_MIN_CHUNK_SIZE;
 }
 
-static void clear_path(pgfgd_Path* p)
+static void* arena_alloc(pgfgd_Arena* a, size_t size)
 {
-  int i;
-  for (i=0; i < p->length; i++)
-    free(p->strings[i]);
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+  pgfgd_ArenaChunk* c = a->chunks;
+  if (!c || c->used + size > c->size) {
+    size_t chunk_size = size > a->next_chunk_size ? size : a->next_chunk_size;
+    c = (pgfgd_ArenaChunk*) calloc(1, ARENA_HEADER_SIZE + chunk_size);
+    c->next = a->chunks;
+    c->size = chunk_size;
+    a->chunks = c;
+    a->next_chunk_size *= 2;
+  }
+
+  void* p = (char*) c + ARENA_HEADER_SIZE + c->used;
+  c->used += size;
+  return p;
+}
+
+static void arena_free(pgfgd_Arena* a)
+{
+  while (a->chunks) {
+    pgfgd_ArenaChunk* next = a->chunks->next;
+    free(a->chunks);
+    a->chunks = next;
+  }
+}
+
+
+// Makes sure that the string (or number) at the top of the stack
+// stays alive during the run of the algorithm and returns it. Each
+// string gets a slot of its own in the anchor array: Two long strings
+// with the same contents need not be the same object, so the string
+// cannot be used as a key.
+static const char* anchor_string(lua_State* L, size_t* length)
+{
+  const char* s = lua_tolstring(L, -1, length);
+  int slot = lua_rawlen(L, STRING_ANCHOR_INDEX) + 1;
+  lua_pushvalue(L, -1);
+  lua_rawseti(L, STRING_ANCHOR_INDEX, slot);
+  return s;
+}
+
 
-  free(p->strings);
+static void clear_path(pgfgd_Path* p)
+{
+  free(p->ops);
   free(p->coordinates);
 
   p->length = 0;
-  p->strings = 0;
+  p->capacity = 0;
+  p->ops = 0;
   p->coordinates = 0;
 }
 
+// The Lua names of the path operations, indexed by pgfgd_PathOp:
+static const char* path_op_names[] = { 0, "moveto", "lineto", "curveto", "closepath" };
+
+#define PATH_OP_COUNT 5
+
+const char* pgfgd_path_op_name(pgfgd_PathOp op)
+{
+  return op > 0 && op < PATH_OP_COUNT ? path_op_names[op] : 0;
+}
+
+static pgfgd_PathOp path_op_from_name(const char* s)
+{
+  int op;
+  for (op = 1; op < PATH_OP_COUNT; op++)
+    if (strcmp(s, path_op_names[op]) == 0)
+      return (pgfgd_PathOp) op;
+  return PGFGD_COORDINATE;
+}
+
 
 
 // Option handling
 
+// Interned keys. Each key is interned only once and the resulting
+// object lives as long as the library is loaded. Once a key has been
+// used with a Lua state, the key's Lua string is stored in the
+// registry so that it can be pushed without hashing it once more.
+
+struct pgfgd_Key {
+  char*        name;
+  unsigned int hash;
+
+  // The position of the key in the table of all interned keys:
+  int          id;
+
+  // A reference to the key's Lua string in the registry of state:
+  lua_State*   state;
+  int          ref;
+};
+
+static pgfgd_Key** interned_keys;
+static int         interned_keys_length;
+
+// Open addressing hash table for the interned keys. An entry of 0
+// means ``empty'', otherwise the id of the key plus one is stored.
+static int*        interned_hash;
+static int         interned_hash_mask;
+
+// Detached algorithms may intern keys from several threads at once:
+#ifdef PGFGD_THREADS
+static pthread_mutex_t interned_lock = PTHREAD_MUTEX_INITIALIZER;
+#define lock_interned_keys()   pthread_mutex_lock(&interned_lock)
+#define unlock_interned_keys() pthread_mutex_unlock(&interned_lock)
+#else
+#define lock_interned_keys()
+#define unlock_interned_keys()
+#endif
+
+
+static unsigned int hash_string(const char* s)
+{
+  // FNV-1a
+  unsigned int h = 2166136261u;
+  while (*s) {
+    h ^= (unsigned char) *s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void insert_interned_key(pgfgd_Key* k)
+{
+  unsigned int i = k->hash & interned_hash_mask;
+  while (interned_hash[i])
+    i = (i+1) & interned_hash_mask;
+  interned_hash[i] = k->id + 1;
+}
+
+pgfgd_key_ref pgfgd_intern(const char* key)
+{
+  unsigned int h = hash_string(key);
+
+  lock_interned_keys();
+  
+  if (interned_hash) {
+    unsigned int i = h & interned_hash_mask;
+    while (interned_hash[i]) {
+      pgfgd_Key* k = interned_keys[interned_hash[i] - 1];
+      if (k->hash == h && strcmp(k->name, key) == 0) {
+	unlock_interned_keys();
+	return k;
+      }
+      i = (i+1) & interned_hash_mask;
+    }
+  }
+
+  // Not found, so intern it.
+  if (2*(interned_keys_length+1) > interned_hash_mask) {
+    // Grow (and rehash) the hash table:
+    int size = interned_hash ? 2*(interned_hash_mask+1) : 64;
+    free(interned_hash);
+    interned_hash = (int*) calloc(size, sizeof(int));
+    interned_hash_mask = size - 1;
+    interned_keys = (pgfgd_Key**) realloc(interned_keys, size/2*sizeof(pgfgd_Key*));
+    
+    int j;
+    for (j = 0; j < interned_keys_length; j++)
+      insert_interned_key(interned_keys[j]);
+  }
+  
+  pgfgd_Key* k = (pgfgd_Key*) calloc(1, sizeof(pgfgd_Key));
+  k->name = strcpy((char*) malloc(strlen(key)+1), key);
+  k->hash = h;
+  k->id   = interned_keys_length++;
+  k->ref  = LUA_NOREF;
+  
+  interned_keys[k->id] = k;
+  insert_interned_key(k);
+
+  unlock_interned_keys();
+  
+  return k;
+}
+
+const char* pgfgd_key_name(pgfgd_key_ref k)
+{
+  return k->name;
+}
+
+static void push_key(lua_State* L, pgfgd_key_ref k)
+{
+  if (k->state == L)
+    lua_rawgeti(L, LUA_REGISTRYINDEX, k->ref);
+  else {
+    lua_pushstring(L, k->name);
+    lua_pushvalue(L, -1);
+    k->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    k->state = L;
+  }
+}
+
+// Pushes t[k] for the table t at position index
+static void get_key(lua_State* L, int index, pgfgd_key_ref k)
+{
+  index = lua_absindex(L, index);
+  push_key(L, k);
+  lua_gettable(L, index);
+}
+
+
+// The set of options an algorithm has declared through
+// pgfgd_key_add_snapshot_option. It is created once when the
+// algorithm is declared and lives as long as the algorithm.
+
+typedef struct pgfgd_OptionKeys {
+  int            length;
+  pgfgd_key_ref* keys;
+
+  // Maps the id of a key to its position in the keys array plus one
+  // (0 means that the key is not part of the snapshot):
+  int            id_limit;
+  int*           position_of_id;
+} pgfgd_OptionKeys;
+
+// The inputs besides the option snapshots that a detached algorithm
+// has declared through pgfgd_key_add_snapshot_digraph and
+// pgfgd_key_add_snapshot_anchor. Like the option keys, they are
+// created once when the algorithm is declared.
+
+typedef struct pgfgd_DetachedInputs {
+  int            digraphs_length;
+  pgfgd_key_ref* digraphs;
+
+  int            anchors_length;
+  pgfgd_key_ref* anchors;
+} pgfgd_DetachedInputs;
+
+// The value of an option at the time the snapshot was taken. The
+// fields mirror the different lua_isxxx and lua_toxxx functions.
+
+typedef struct pgfgd_OptionValue {
+  int         type;
+  int         is_number;
+  double      number;
+  int         boolean;
+  const char* string; // Only set for strings and numbers.
+  size_t      string_length;
+  void*       user;
+} pgfgd_OptionValue;
+
+// Everything that belongs to a single run of an algorithm:
+
+// The anchors of a vertex that have already been computed:
+
+typedef struct pgfgd_AnchorEntry {
+  pgfgd_key_ref name;
+  int           found;
+  double        x;
+  double        y;
+} pgfgd_AnchorEntry;
+
+typedef struct pgfgd_AnchorCache {
+  int                length;
+  int                capacity;
+  pgfgd_AnchorEntry* entries;
+} pgfgd_AnchorCache;
+
+#define MAX_TIMED_PHASES 16
+
+// A hash table from the vertices of a vertices array to their
+// indices, see vertex_slot. The vertices are identified by
+// lua_topointer.
+typedef struct pgfgd_SlotIndex {
+  const void** vertices; // 0 marks an empty entry
+  int*         slots;
+  unsigned int mask;
+} pgfgd_SlotIndex;
+
+struct pgfgd_SyntacticDigraph_internals {
+  lua_State* state;
+
+  // All vertices, edges, option tables and vertex paths:
+  pgfgd_Arena arena;
+
+  // The anchor caches of the vertices, indexed by array_index:
+  pgfgd_AnchorCache* anchors;
+
+  // The positions of the vertices before the algorithm was run,
+  // indexed by array_index:
+  pgfgd_Coordinate* initial_pos;
+
+  // The x and y arrays of the syntactic digraph:
+  double* x;
+  double* y;
+
+  // Whether the Lua path of an edge is still the straight line from
+  // its tail anchor to its head anchor that Edge.new creates, indexed
+  // by array_index:
+  unsigned char* default_paths;
+
+  // Computed on demand by syntactic_arc_offsets:
+  int* arc_offsets;
+  int  arc_offsets_length;
+
+  // Used by vertex_slot for the vertices of the syntactic digraph:
+  pgfgd_SlotIndex slots;
+
+  // Set while a detached algorithm runs. All queries must then be
+  // answered from what has been extracted beforehand:
+  int detached;
+
+  // The digraphs extracted for a detached algorithm:
+  int             digraphs_length;
+  pgfgd_Digraph** digraphs;
+
+  // The algorithm function and its user data:
+  pgfgd_algorithm_fun fun;
+  void*               user;
+
+  // The value of the gd threads option:
+  int threads;
+
+  // The times spent in the phases of the run, see pgfgd_add_phase_time:
+  int         timed_phases_length;
+  const char* timed_phases[MAX_TIMED_PHASES];
+  double      phase_times[MAX_TIMED_PHASES];
+
+  // The value of the gd timing option:
+  int timing;
+};
+
 struct pgfgd_OptionTable {
   lua_State* state;
+  pgfgd_SyntacticDigraph_internals* internals;
 
   int kind;
   int index;
+
+  // Snapshot of the options in keys or 0 if there is no snapshot:
+  const pgfgd_OptionKeys* keys;
+  pgfgd_OptionValue*      snapshot;
 };
 
-// These are the indices of the parameters during a run of the main
-// algorithm:  
-#define GRAPH_INDEX 1
-#define VERTICES_INDEX 2
-#define EDGES_INDEX 3
-#define ALGORITHM_INDEX 4
 
-// This is the index of a special table mapping vertices back to the
-// index they have. It is created in the C code, but stays on the
-// stack during the computations.
-#define BACKINDEX_STORAGE_INDEX 5
+static pgfgd_OptionKeys* make_option_keys(int length, const char** keys)
+{
+  pgfgd_OptionKeys* k = (pgfgd_OptionKeys*) calloc(1, sizeof(pgfgd_OptionKeys));
 
-// These are the positions of different upvalues for the C closure of
-// a C algorithm.
-#define FUNCTION_UPVALUE 1
-#define USER_UPVALUE 2
-#define DIGRAPH_OBJECT_UPVALUE 3
+  k->keys = (pgfgd_key_ref*) calloc(length, sizeof(pgfgd_key_ref));
+  
+  int i;
+  for (i = 0; i < length; i++)
+    k->keys[i] = pgfgd_intern(keys[i]);
 
+  k->id_limit = interned_keys_length;
+  k->position_of_id = (int*) calloc(k->id_limit, sizeof(int));
+  
+  // Remove duplicates:
+  for (i = 0; i < length; i++) {
+    pgfgd_key_ref key = k->keys[i];
+    if (!k->position_of_id[key->id]) {
+      k->keys[k->length] = key;
+      k->position_of_id[key->id] = ++k->length;
+    }
+  }
+  
+  return k;
+}
+
+// Numbers are converted to strings only when the string is asked
+// for, see pgfgd_tostring_view_ref. A detached algorithm cannot ask
+// Lua then, so for its snapshots, number_strings is the arena that
+// the string of each number is copied to right away.
+static void read_option_value(lua_State* L, pgfgd_OptionValue* o, pgfgd_Arena* number_strings)
+{
+  /* Value must be on top of stack. */
+  o->type      = lua_type(L, -1);
+  o->is_number = lua_isnumber(L, -1);
+  o->number    = lua_tonumber(L, -1);
+  o->boolean   = lua_toboolean(L, -1);
+  o->user      = lua_touserdata(L, -1);
+  o->string    = 0;
+  o->string_length = 0;
+
+  if (o->type == LUA_TSTRING)
+    o->string = anchor_string(L, &o->string_length);
+  else if (o->type == LUA_TNUMBER && number_strings) {
+    const char* s = lua_tolstring(L, -1, &o->string_length);
+    char* copy = (char*) arena_alloc(number_strings, o->string_length + 1);
+    memcpy(copy, s, o->string_length + 1);
+    o->string = copy;
+  }
+}
+
+static pgfgd_OptionValue* make_snapshot(lua_State* L, const pgfgd_OptionKeys* k, pgfgd_Arena* arena, int detached)
+{
+  /* Options table must be on top of stack. */
+  pgfgd_OptionValue* snapshot = (pgfgd_OptionValue*) arena_alloc(arena, k->length * sizeof(pgfgd_OptionValue));
+
+  int i;
+  for (i = 0; i < k->length; i++) {
+    get_key(L, -1, k->keys[i]);
+    read_option_value(L, snapshot + i, detached ? arena : 0);
+    lua_pop(L, 1);
+  }
+
+  return snapshot;
+}
+
+static const pgfgd_OptionValue* snapshot_value(pgfgd_OptionTable* t, pgfgd_key_ref key)
+{
+  // Options that are not part of the snapshot of a detached
+  // algorithm are never set:
+  static const pgfgd_OptionValue unset = { LUA_TNIL, 0, 0, 0, 0, 0, 0 };
+  
+  if (t->snapshot && key->id < t->keys->id_limit) {
+    int pos = t->keys->position_of_id[key->id];
+    if (pos)
+      return t->snapshot + pos - 1;
+  }
+  return t->internals->detached ? &unset : 0;
+}
 
-static pgfgd_OptionTable* make_option_table(lua_State* L, int kind, int index)
+static pgfgd_OptionTable* make_option_table(pgfgd_SyntacticDigraph_internals* internals, int kind, int index)
 {
-  pgfgd_OptionTable* t = (pgfgd_OptionTable*) malloc(sizeof(pgfgd_OptionTable));
+  pgfgd_OptionTable* t = (pgfgd_OptionTable*) arena_alloc(&internals->arena, sizeof(pgfgd_OptionTable));
 
-  t->state = L;
+  t->state = internals->state;
+  t->internals = internals;
   t->kind = kind;
   t->index = index;
 
   return t;
 }
 
+static pgfgd_key_ref options_key(void)
+{
+  static pgfgd_key_ref k;
+  if (!k)
+    k = pgfgd_intern("options");
+  return k;
+}
+
+static void snapshot_option_table(pgfgd_OptionTable* t, const pgfgd_OptionKeys* k, pgfgd_Arena* arena, int detached)
+{
+  /* Object owning the options must be on top of stack. */
+  if (k) {
+    get_key(t->state, -1, options_key());
+    t->keys = k;
+    t->snapshot = make_snapshot(t->state, k, arena, detached);
+    lua_pop(t->state, 1);
+  }
+}
+
 static void push_option_table(pgfgd_OptionTable* t)
 {
   switch (t->kind) {
   case GRAPH_INDEX:
-    lua_getfield(t->state, GRAPH_INDEX, "options");
+    get_key(t->state, GRAPH_INDEX, options_key());
     break;
   case VERTICES_INDEX:
     lua_rawgeti(t->state, VERTICES_INDEX, t->index);
-    lua_getfield(t->state, -1, "options");
+    get_key(t->state, -1, options_key());
     lua_replace(t->state, -2);
     break;
   case EDGES_INDEX:
     lua_rawgeti(t->state, EDGES_INDEX, t->index);
-    lua_getfield(t->state, -1, "options");
+    get_key(t->state, -1, options_key());
     lua_replace(t->state, -2);
     break;
   }
 }
 
-int pgfgd_isset(pgfgd_OptionTable* t, const char* key)
+// Pushes the option table and the value of the key onto the stack.
+static void push_option(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
   push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  get_key(t->state, -1, key);
+}
+
+int pgfgd_isset_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
+{
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->type != LUA_TNIL;
+  
+  push_option(t, key);
   int is_nil = lua_isnil(t->state, -1);
   lua_pop(t->state, 2);
   return !is_nil;
 }
 
-int pgfgd_isnumber(pgfgd_OptionTable* t, const char* key)
+int pgfgd_isnumber_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->is_number;
+  
+  push_option(t, key);
   int is_number = lua_isnumber(t->state, -1);
   lua_pop(t->state, 2);
   return is_number;
 }
 
-int pgfgd_isboolean(pgfgd_OptionTable* t, const char* key)
+int pgfgd_isboolean_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->type == LUA_TBOOLEAN;
+  
+  push_option(t, key);
   int is_bool = lua_isboolean(t->state, -1);
   lua_pop(t->state, 2);
   return is_bool;
 }
 
-int pgfgd_isstring(pgfgd_OptionTable* t, const char* key)
+int pgfgd_isstring_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->type == LUA_TSTRING || o->type == LUA_TNUMBER;
+  
+  push_option(t, key);
   int is_string = lua_isstring(t->state, -1);
   lua_pop(t->state, 2);
   return is_string;
 }
 
-int pgfgd_isuser(pgfgd_OptionTable* t, const char* key)
+int pgfgd_isuser_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->type == LUA_TUSERDATA || o->type == LUA_TLIGHTUSERDATA;
+  
+  push_option(t, key);
   int is_user = lua_isuserdata(t->state, -1);
   lua_pop(t->state, 2);
   return is_user;
 }
 
 
-double pgfgd_tonumber(pgfgd_OptionTable* t, const char* key)
+double pgfgd_tonumber_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->number;
+  
+  push_option(t, key);
   double d = lua_tonumber(t->state, -1);
   lua_pop(t->state, 2);
   return d;
 }
 
-int pgfgd_toboolean(pgfgd_OptionTable* t, const char* key)
+int pgfgd_toboolean_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->boolean;
+  
+  push_option(t, key);
   int d = lua_toboolean(t->state, -1);
   lua_pop(t->state, 2);
   return d;
 }
 
-char* pgfgd_tostring(pgfgd_OptionTable* t, const char* key)
+const char* pgfgd_tostring_view_ref(pgfgd_OptionTable* t, pgfgd_key_ref key, size_t* length)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
-  const char* s = lua_tostring(t->state, -1);
-  char* copy = strcpy((char*) malloc(strlen(s)+1), s);
+  const char* s = 0;
+  size_t l = 0;
+  
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o && (o->string || o->type != LUA_TNUMBER)) {
+    s = o->string;
+    l = o->string_length;
+  }
+  else {
+    push_option(t, key);
+    if (lua_isstring(t->state, -1))
+      s = anchor_string(t->state, &l);
+    lua_pop(t->state, 2);
+  }
+  
+  if (length)
+    *length = l;
+  return s;
+}
+
+static char* copy_string(const char* s, size_t length)
+{
+  char* copy = (char*) malloc(length+1);
+  memcpy(copy, s, length+1);
+  return copy;
+}
+
+// Unlike pgfgd_tostring_view_ref, this copies the string right away,
+// so it need not be anchored:
+char* pgfgd_tostring_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
+{
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o && (o->string || o->type != LUA_TNUMBER))
+    return o->string ? copy_string(o->string, o->string_length) : 0;
+  
+  char* copy = 0;
+  size_t length;
+  push_option(t, key);
+  const char* s = lua_tolstring(t->state, -1, &length);
+  if (s)
+    copy = copy_string(s, length);
   lua_pop(t->state, 2);
   return copy;
 }
 
-void* pgfgd_touser(pgfgd_OptionTable* t, const char* key)
+void* pgfgd_touser_ref(pgfgd_OptionTable* t, pgfgd_key_ref key)
 {
-  push_option_table(t);
-  lua_getfield(t->state, -1, key);
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (o)
+    return o->user;
+  
+  push_option(t, key);
   void* d = lua_touserdata(t->state, -1);
   lua_pop(t->state, 2);
   return d;
 }
 
+void pgfgd_option_ref(pgfgd_OptionTable* t, pgfgd_key_ref key, pgfgd_Option* option)
+{
+  pgfgd_OptionValue value;
+  
+  const pgfgd_OptionValue* o = snapshot_value(t, key);
+  if (!o) {
+    push_option(t, key);
+    read_option_value(t->state, &value, 0);
+    lua_pop(t->state, 2);
+    o = &value;
+  }
 
-// Handling algorithms
+  option->is_set        = o->type != LUA_TNIL;
+  option->is_number     = o->is_number;
+  option->is_boolean    = o->type == LUA_TBOOLEAN;
+  option->is_string     = o->type == LUA_TSTRING || o->type == LUA_TNUMBER;
+  option->is_user       = o->type == LUA_TUSERDATA || o->type == LUA_TLIGHTUSERDATA;
+  option->number        = o->number;
+  option->boolean       = o->boolean;
+  option->string        = o->string;
+  option->string_length = o->string_length;
+  option->user          = o->user;
 
-struct pgfgd_SyntacticDigraph_internals {
-  lua_State* state;
-};
+  // A number that has not been converted, yet:
+  if (option->is_string && !option->string)
+    option->string = pgfgd_tostring_view_ref(t, key, &option->string_length);
+}
+
+int pgfgd_isset(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_isset_ref(t, pgfgd_intern(key));
+}
+
+int pgfgd_isnumber(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_isnumber_ref(t, pgfgd_intern(key));
+}
+
+int pgfgd_isboolean(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_isboolean_ref(t, pgfgd_intern(key));
+}
+
+int pgfgd_isstring(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_isstring_ref(t, pgfgd_intern(key));
+}
+
+int pgfgd_isuser(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_isuser_ref(t, pgfgd_intern(key));
+}
+
+double pgfgd_tonumber(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_tonumber_ref(t, pgfgd_intern(key));
+}
+
+int pgfgd_toboolean(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_toboolean_ref(t, pgfgd_intern(key));
+}
 
-static char* make_string_from(lua_State* L, const char* name)
+char* pgfgd_tostring(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_tostring_ref(t, pgfgd_intern(key));
+}
+
+const char* pgfgd_tostring_view(pgfgd_OptionTable* t, const char* key, size_t* length)
 {
+  return pgfgd_tostring_view_ref(t, pgfgd_intern(key), length);
+}
+
+void* pgfgd_touser(pgfgd_OptionTable* t, const char* key)
+{
+  return pgfgd_touser_ref(t, pgfgd_intern(key));
+}
+
+
+// Handling algorithms
+
+static const char* borrow_string_from(lua_State* L, const char* name, size_t* length)
+{
+  const char* s = "";
+  *length = 0;
+  
   lua_getfield(L, -1, name);
-  if (lua_isnil(L, -1)) {
-    // Field not set; return empty string.
-    lua_pop(L, 1);
-    return (char*) calloc(1, sizeof(char));
-  }
-  else {
-    const char* s = lua_tostring(L, -1);
-    char* copy = strcpy((char*) malloc(strlen(s)+1), s);
-    lua_pop(L, 1);
-    return copy;
-  }
+  if (lua_type(L, -1) == LUA_TSTRING)
+    // The string is stored in the object, so it stays alive:
+    s = lua_tolstring(L, -1, length);
+  else if (lua_isnumber(L, -1))
+    s = anchor_string(L, length);
+  lua_pop(L, 1);
+  
+  return s;
 }
 
 static void make_coordinate(lua_State* L, pgfgd_Coordinate* c)
@@ -248,68 +840,226 @@ static void make_coordinate(lua_State* L, pgfgd_Coordinate* c)
   lua_pop(L, 1);
 }
 
-static pgfgd_Path* make_empty_path(lua_State* L)
+static pgfgd_Path* make_empty_path(pgfgd_Arena* arena)
+{
+  return (pgfgd_Path*) arena_alloc(arena, sizeof(pgfgd_Path));
+}
+
+// Checks whether the path on top of the stack is a line between two
+// coordinate factories, like the path that Edge.new creates from the
+// tail anchor to the head anchor of an edge:
+static int is_default_path(lua_State* L)
 {
-  return (pgfgd_Path*) calloc(1, sizeof(pgfgd_Path));
+  int result = lua_istable(L, -1) && lua_rawlen(L, -1) == 4;
+  int i;
+  for (i = 1; result && i <= 4; i++) {
+    lua_rawgeti(L, -1, i);
+    if (i % 2)
+      result = lua_type(L, -1) == LUA_TSTRING && !strcmp(lua_tostring(L, -1), i == 1 ? "moveto" : "lineto");
+    else
+      result = lua_isfunction(L, -1);
+    lua_pop(L, 1);
+  }
+  return result;
 }
 
-static pgfgd_Path* make_path(lua_State* L)
+static pgfgd_Path* make_path(lua_State* L, pgfgd_Arena* arena)
 {
   /* Path object must be on top of stack. */
-  pgfgd_Path* p = make_empty_path(L);
+  pgfgd_Path* p = make_empty_path(arena);
+
+  // Fill path. Since vertex paths are never changed, their arrays
+  // can live in the arena as well:
+  int path_length = lua_rawlen(L, -1);
+  if (path_length > 0) {
+    p->length      = path_length;
+    p->capacity    = path_length;
+    p->coordinates = (pgfgd_Coordinate*) arena_alloc(arena, path_length * sizeof(pgfgd_Coordinate));
+    p->ops         = (unsigned char*) arena_alloc(arena, path_length * sizeof(unsigned char));
+    int i;
+    for (i = 0; i < path_length; i++) {
+      lua_rawgeti(L, -1, i+1);
+      if (lua_type(L, -1) == LUA_TSTRING)
+	p->ops[i] = path_op_from_name(lua_tostring(L, -1));
+      else {
+	lua_getfield(L, -1, "x");
+	p->coordinates[i].x = lua_tonumber(L, -1);
+	lua_pop(L, 1);
+	
+	lua_getfield(L, -1, "y");
+	p->coordinates[i].y = lua_tonumber(L, -1);
+	lua_pop(L, 1);
+      }
+      lua_pop(L, 1);
+    }       
+  }
+
+  return p;
+}
+
+static unsigned int hash_pointer(const void* p)
+{
+  return (unsigned int) ((size_t) p >> 3) * 0x9E3779B1u;
+}
+
+static void build_slot_index(lua_State* L, int vertices_pos, pgfgd_SlotIndex* index)
+{
+  int n = lua_rawlen(L, vertices_pos);
+
+  // Keep the load factor at most 1/2:
+  unsigned int size = 16;
+  while (size < 2 * (unsigned int) n)
+    size *= 2;
+  index->vertices = (const void**) calloc(size, sizeof(const void*));
+  index->slots    = (int*) calloc(size, sizeof(int));
+  index->mask     = size - 1;
+
+  int slot;
+  for (slot = 1; slot <= n; slot++) {
+    lua_rawgeti(L, vertices_pos, slot);
+    const void* v = lua_topointer(L, -1);
+    lua_pop(L, 1);
+    
+    unsigned int i = hash_pointer(v) & index->mask;
+    while (index->vertices[i] && index->vertices[i] != v)
+      i = (i+1) & index->mask;
+    if (!index->vertices[i]) {
+      index->vertices[i] = v;
+      index->slots[i]    = slot;
+    }
+  }
+}
+
+static void free_slot_index(pgfgd_SlotIndex* index)
+{
+  free(index->vertices);
+  free(index->slots);
+}
+
+// Pops the vertex on top of the stack and returns its slot, which is
+// its index in the vertices array at vertices_pos, or 0 if it is not
+// in this array. The slots table at slots_pos is maintained by the
+// Lua Digraph class. Should the vertex be missing from it or should
+// it be stale because the vertices array was changed behind the
+// digraph's back, the vertex is looked up in the index instead, which
+// is built on the first such miss.
+static int vertex_slot(lua_State* L, int vertices_pos, int slots_pos, pgfgd_SlotIndex* index)
+{
+  lua_pushvalue(L, -1);
+  lua_rawget(L, slots_pos);
+  int slot = lua_tointeger(L, -1);
+  lua_pop(L, 1);
+  
+  int valid = 0;
+  if (slot >= 1) {
+    lua_rawgeti(L, vertices_pos, slot);
+    valid = lua_rawequal(L, -1, -2);
+    lua_pop(L, 1);
+  }
+  
+  if (!valid) {
+    if (!index->vertices)
+      build_slot_index(L, vertices_pos, index);
+
+    const void* v = lua_topointer(L, -1);
+    unsigned int i = hash_pointer(v) & index->mask;
+    while (index->vertices[i] && index->vertices[i] != v)
+      i = (i+1) & index->mask;
+    slot = v ? index->slots[i] : 0;
+  }
+  lua_pop(L, 1);
+  
+  return slot >= 1 ? slot : 0;
+}
+
+// Returns the slots of the tails and heads of all edges, the tail of
+// the edge with array_index i at position 2*i and its head at
+// 2*i+1. This is done before anything else is allocated for the
+// digraph, so that the error raised for an edge whose vertex is not
+// in the graph leaks nothing.
+static int* edge_end_slots(lua_State* L, int edge_count, pgfgd_SlotIndex* index)
+{
+  int* ends = (int*) malloc((2 * edge_count + 1) * sizeof(int));
+
+  int i, missing = 0;
+  for (i = 0; i < edge_count && !missing; i++) {
+    lua_rawgeti(L, EDGES_INDEX, i+1);
+    lua_getfield(L, -1, "tail");
+    ends[2*i] = vertex_slot(L, VERTICES_INDEX, SLOTS_INDEX, index);
+    lua_getfield(L, -1, "head");
+    ends[2*i+1] = vertex_slot(L, VERTICES_INDEX, SLOTS_INDEX, index);
+    lua_pop(L, 1);
 
-  // Fill path:
-  int path_length = lua_rawlen(L, -1);
-  if (path_length > 0) {
-    init_path(p, path_length);
-    int i;
-    for (i = 0; i < path_length; i++) {
-      lua_rawgeti(L, -1, i+1);
-      if (lua_isstring(L, -1)) {
-	const char* s = lua_tostring(L, -1);
-	p->strings[i] = strcpy((char*) malloc(strlen(s)+1), s);
-      } else {
-	lua_getfield(L, -1, "x");
-	p->coordinates[i].x = lua_tonumber(L, -1);
-	lua_pop(L, 1);
-	
-	lua_getfield(L, -1, "y");
-	p->coordinates[i].y = lua_tonumber(L, -1);
-	lua_pop(L, 1);
-      }
-      lua_pop(L, 1);
-    }       
+    missing = !ends[2*i] || !ends[2*i+1];
   }
 
-  return p;
+  if (missing) {
+    free(ends);
+    free_slot_index(index);
+    luaL_error(L, "edge refers to a vertex that is not in the graph");
+  }
+  
+  return ends;
 }
 
 static void construct_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
 {
+  int vertex_count = lua_rawlen(L, VERTICES_INDEX);
+  int edge_count   = lua_rawlen(L, EDGES_INDEX);
+
+  pgfgd_SlotIndex slots = { 0, 0, 0 };
+  int* ends = edge_end_slots(L, edge_count, &slots);
+
   d->internals = (pgfgd_SyntacticDigraph_internals*) calloc(1, sizeof(pgfgd_SyntacticDigraph_internals));
   d->internals->state = L;
+  d->internals->slots = slots;
+
+  // Size the arena so that typical graphs fit into its first chunk:
+  pgfgd_Arena* arena = &d->internals->arena;
+  arena_init(arena,
+	     vertex_count * (sizeof(pgfgd_Vertex*) + sizeof(pgfgd_Vertex) + sizeof(pgfgd_OptionTable) + 4 * sizeof(double)) +
+	     edge_count * (3 * sizeof(pgfgd_Edge*) + sizeof(pgfgd_Edge) + sizeof(pgfgd_OptionTable) + sizeof(pgfgd_Path) + 32));
+  
+  // The options that should be snapshot, if any:
+  const pgfgd_OptionKeys* keys = lua_touserdata(L, lua_upvalueindex(OPTION_KEYS_UPVALUE));
+  int detached = lua_touserdata(L, lua_upvalueindex(DETACHED_INPUTS_UPVALUE)) != 0;
   
   // Create the options table:
-  d->options = make_option_table(L, GRAPH_INDEX, 0);
+  d->options = make_option_table(d->internals, GRAPH_INDEX, 0);
+  lua_pushvalue(L, GRAPH_INDEX);
+  snapshot_option_table(d->options, keys, arena, detached);
+  lua_pop(L, 1);
+
+  // Needed by pgfgd_parallel_for, which may be called detached:
+  d->internals->threads = (int) pgfgd_tonumber(d->options, "gd threads");
+  d->internals->timing = pgfgd_toboolean(d->options, "gd timing");
 
   // Create the vertex table
-  init_vertex_array(&d->vertices, lua_rawlen(L, VERTICES_INDEX));
+  d->vertices.length = vertex_count;
+  d->vertices.array  = (pgfgd_Vertex**) arena_alloc(arena, vertex_count * sizeof(pgfgd_Vertex*));
+  d->internals->anchors = (pgfgd_AnchorCache*) arena_alloc(arena, vertex_count * sizeof(pgfgd_AnchorCache));
+  d->internals->initial_pos = (pgfgd_Coordinate*) arena_alloc(arena, vertex_count * sizeof(pgfgd_Coordinate));
+  d->x = (double*) arena_alloc(arena, vertex_count * sizeof(double));
+  d->y = (double*) arena_alloc(arena, vertex_count * sizeof(double));
+  d->internals->x = d->x;
+  d->internals->y = d->y;
 
   // Create the vertices
   int i;
   for (i=0; i<d->vertices.length; i++) {
-    pgfgd_Vertex* v  = (pgfgd_Vertex*) calloc(1, sizeof(pgfgd_Vertex));
+    pgfgd_Vertex* v  = (pgfgd_Vertex*) arena_alloc(arena, sizeof(pgfgd_Vertex));
 
     // Push the vertex onto the Lua stack:
     lua_rawgeti(L, VERTICES_INDEX, i+1);
     
     // Fill v with information:
-    v->name  = make_string_from(L, "name");
-    v->shape = make_string_from(L, "shape");
-    v->kind  = make_string_from(L, "kind");
+    v->name  = borrow_string_from(L, "name", &v->name_length);
+    v->shape = borrow_string_from(L, "shape", &v->shape_length);
+    v->kind  = borrow_string_from(L, "kind", &v->kind_length);
     
     // Options:
-    v->options = make_option_table(L, VERTICES_INDEX, i+1);
+    v->options = make_option_table(d->internals, VERTICES_INDEX, i+1);
+    snapshot_option_table(v->options, keys, arena, detached);
     
     // Index:
     v->array_index = i;
@@ -318,11 +1068,12 @@ static void construct_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
     lua_getfield(L, -1, "pos");
     make_coordinate(L, &v->pos);
     lua_pop(L, 1);
+    d->internals->initial_pos[i] = v->pos;
+    d->x[i] = v->pos.x;
+    d->y[i] = v->pos.y;
 
-    // Setup path array:
-    lua_getfield(L, -1, "path");
-    v->path = make_path(L);
-    lua_pop(L, 1); 
+    // The path is only set up when it is needed, see
+    // pgfgd_vertex_path.
 
     // Pop the vertex
     lua_pop(L, 1);
@@ -331,91 +1082,155 @@ static void construct_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
   }
 
   // Construct the edges:
-  init_edge_array(&d->syntactic_edges, lua_rawlen(L, EDGES_INDEX));
+  d->internals->default_paths = (unsigned char*) arena_alloc(arena, edge_count);
+  d->syntactic_edges.length = edge_count;
+  d->syntactic_edges.array  = (pgfgd_Edge**) arena_alloc(arena, edge_count * sizeof(pgfgd_Edge*));
 
   int edge_index;
   for (edge_index = 0; edge_index < d->syntactic_edges.length; edge_index++) {
-    pgfgd_Edge* e = (pgfgd_Edge*) calloc(1, sizeof(pgfgd_Edge));
+    pgfgd_Edge* e = (pgfgd_Edge*) arena_alloc(arena, sizeof(pgfgd_Edge));
 
     lua_rawgeti(L, EDGES_INDEX, edge_index+1);
     
-    e->direction = make_string_from(L, "direction");      
-    e->options = make_option_table(L, EDGES_INDEX, edge_index+1);
+    e->direction = borrow_string_from(L, "direction", &e->direction_length);
+    e->options = make_option_table(d->internals, EDGES_INDEX, edge_index+1);
+    snapshot_option_table(e->options, keys, arena, detached);
     
     // Index:
     e->array_index = edge_index;
 
-    // Compute the tail vertex index:
-    lua_getfield(L, -1, "tail");
-    lua_gettable(L, VERTICES_INDEX);
-    e->tail = d->vertices.array[lua_tointeger(L, -1) - 1];
-    lua_pop(L, 1);
-
-    lua_getfield(L, -1, "head");
-    lua_gettable(L, VERTICES_INDEX);
-    e->head = d->vertices.array[lua_tointeger(L, -1) - 1];
-    lua_pop(L, 1);
+    // The tail and head vertices:
+    e->tail = d->vertices.array[ends[2*edge_index] - 1];
+    e->head = d->vertices.array[ends[2*edge_index+1] - 1];
     
-    // Fill path:
-    e->path = make_empty_path(L);
-    e->path->length = -1; // Means that a default path should be created.
+    // Fill path. Only the path object is taken from the arena, its
+    // arrays are managed by the pgfgd_path_xxx functions:
+    e->path = make_empty_path(arena);
+    e->path->length = -1; // Means that the path has not been modified.
+    lua_getfield(L, -1, "path");
+    d->internals->default_paths[edge_index] = is_default_path(L);
+    lua_pop(L, 1);
     
     // Pop the edge form the Lua stack:
     lua_pop(L, 1);
       
     d->syntactic_edges.array[edge_index] = e;
+
+    e->tail->outgoing.length++;
+    e->head->incoming.length++;
+  }
+  free(ends);
+
+  // Distribute the edges to the incoming and outgoing arrays of the
+  // vertices by a counting sort: All of these arrays are slices of
+  // two buffers and the edges keep the order of syntactic_edges.
+  pgfgd_Edge** outgoing = (pgfgd_Edge**) arena_alloc(arena, edge_count * sizeof(pgfgd_Edge*));
+  pgfgd_Edge** incoming = (pgfgd_Edge**) arena_alloc(arena, edge_count * sizeof(pgfgd_Edge*));
+  
+  for (i=0; i<d->vertices.length; i++) {
+    pgfgd_Vertex* v = d->vertices.array[i];
+
+    v->outgoing.array = outgoing;
+    outgoing += v->outgoing.length;
+    v->outgoing.length = 0;
+
+    v->incoming.array = incoming;
+    incoming += v->incoming.length;
+    v->incoming.length = 0;
+  }
+
+  for (edge_index = 0; edge_index < d->syntactic_edges.length; edge_index++) {
+    pgfgd_Edge* e = d->syntactic_edges.array[edge_index];
+
+    e->tail->outgoing.array[e->tail->outgoing.length++] = e;
+    e->head->incoming.array[e->head->incoming.length++] = e;
   }
 }
 
 
-static void sync_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
+// Computes the position of a vertex set by the algorithm: A changed
+// pos field takes precedence over the x and y arrays.
+static void vertex_position(pgfgd_Vertex* v, double* x, double* y)
+{
+  pgfgd_SyntacticDigraph_internals* internals = v->options->internals;
+  const pgfgd_Coordinate* initial = &internals->initial_pos[v->array_index];
+
+  if (v->pos.x != initial->x || v->pos.y != initial->y) {
+    *x = v->pos.x;
+    *y = v->pos.y;
+  }
+  else {
+    *x = internals->x[v->array_index];
+    *y = internals->y[v->array_index];
+  }
+}
+
+// Returns the number of coordinates on the paths written back.
+static int sync_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
 {
-  // Writes back the computed position information to the digraph:
+  int path_points = 0;
+
+  int tos = lua_gettop(L);
+
+  // The keys of a Coordinate, pushed only once:
+  lua_pushliteral(L, "x");
+  int x_index = lua_gettop(L);
+  lua_pushliteral(L, "y");
+  int y_index = lua_gettop(L);
+
+  // The names of the path operations, also pushed only once:
+  int op;
+  for (op = 1; op < PATH_OP_COUNT; op++)
+    lua_pushstring(L, path_op_names[op]);
+  int op_names_index = y_index; // The name of op is at op_names_index + op
+  
+  // Writes back the computed position information to the digraph,
+  // but only for the vertices that have moved:
   int i;
   for (i=0; i<d->vertices.length; i++) {
 
+    const pgfgd_Coordinate* initial = &d->internals->initial_pos[i];
+    double x, y;
+    vertex_position(d->vertices.array[i], &x, &y);
+    if (x == initial->x && y == initial->y)
+      continue;
+    
     // Push pos field of vertex:
     lua_rawgeti(L, VERTICES_INDEX, i+1);
     lua_getfield(L, -1, "pos");
 
     // Set x and y coordinates:
-    pgfgd_Vertex* v = d->vertices.array[i]; 
-    lua_pushnumber(L, v->pos.x);
-    lua_setfield(L, -2, "x");
-    lua_pushnumber(L, v->pos.y);
-    lua_setfield(L, -2, "y");
+    lua_pushvalue(L, x_index);
+    lua_pushnumber(L, x);
+    lua_rawset(L, -3);
+    lua_pushvalue(L, y_index);
+    lua_pushnumber(L, y);
+    lua_rawset(L, -3);
 
     // pop pos and vertex
     lua_pop(L, 2);
   }
 
-  // Write back the paths
-
-  int tos = lua_gettop(L);
-  
-  // First, get "Coordinate.new" as a "local"
-  lua_getglobal(L, "require");
-  lua_pushstring(L, "pgf.gd.model.Path");
-  lua_call(L, 1, 1);
-  int Path_index = lua_gettop(L);
-  
-  lua_getglobal(L, "require");
-  lua_pushstring(L, "pgf.gd.model.Coordinate");
-  lua_call(L, 1, 1);
-  lua_getfield(L, -1, "new");
-  
-  int Coordinate_new_index = lua_gettop(L);
+  // Write back the paths. The Path and Coordinate classes, which are
+  // also the metatables of their objects, are stored as upvalues.
+  int Path_index = lua_upvalueindex(PATH_CLASS_UPVALUE);
+  int Coordinate_index = lua_upvalueindex(COORDINATE_CLASS_UPVALUE);
   
   for (i=0; i < d->syntactic_edges.length; i++) {
     pgfgd_Edge* e = d->syntactic_edges.array[i];
 
-    lua_rawgeti(L, EDGES_INDEX, i+1);
-
+    // Paths that have not been modified by the algorithm get the
+    // default path, a line from the tail anchor to the head
+    // anchor. Edges whose Lua path is such a line already are left
+    // alone:
     if (e->path->length == -1) {
-      // Create default path
+      if (d->internals->default_paths[i])
+	continue;
       pgfgd_path_append_moveto_tail(e);
       pgfgd_path_append_lineto_head(e);
-    } 
+    }
+    
+    lua_rawgeti(L, EDGES_INDEX, i+1);
     
     lua_createtable(L, e->path->length ? e->path->length : 1, MIN_HASH_SIZE_FIX);
     lua_pushvalue(L, Path_index);
@@ -423,16 +1238,23 @@ static void sync_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
 
     int j;
     for (j=0; j<e->path->length; j++) {
-      if (e->path->strings[j]) {
-	lua_pushstring(L, e->path->strings[j]);
+      if (e->path->ops[j]) {
+	lua_pushvalue(L, op_names_index + e->path->ops[j]);
 	lua_rawseti(L, -2, j+1);
       } else {
-	lua_pushvalue(L, Coordinate_new_index);
+	// This does what Coordinate.new does:
+	lua_createtable(L, 0, 2);
+	lua_pushvalue(L, x_index);
 	lua_pushnumber(L, e->path->coordinates[j].x);
+	lua_rawset(L, -3);
+	lua_pushvalue(L, y_index);
 	lua_pushnumber(L, e->path->coordinates[j].y);
-	lua_call(L, 2, 1);
+	lua_rawset(L, -3);
+	lua_pushvalue(L, Coordinate_index);
+	lua_setmetatable(L, -2);
 	
 	lua_rawseti(L, -2, j+1);
+	path_points++;
       }
     }
 
@@ -441,78 +1263,273 @@ static void sync_digraph(lua_State* L, pgfgd_SyntacticDigraph* d)
   }
   
   lua_settop(L, tos);  // Cleanup
+
+  return path_points;
 }
 
 
 static void free_digraph(pgfgd_SyntacticDigraph* digraph)
 {
   int i;
-  for (i=0; i < digraph->vertices.length; i++) {
-    pgfgd_Vertex* v = digraph->vertices.array[i];
+  
+  // Edge paths may have been changed by the algorithm, so their
+  // arrays do not live in the arena:
+  for (i=0; i < digraph->syntactic_edges.length; i++)
+    clear_path(digraph->syntactic_edges.array[i]->path);
+
+  // The digraphs extracted for a detached algorithm:
+  for (i=0; i < digraph->internals->digraphs_length; i++)
+    pgfgd_digraph_free(digraph->internals->digraphs[i]);
+  free(digraph->internals->digraphs);
+
+  // Everything else does:
+  arena_free(&digraph->internals->arena);
+  free(digraph->internals->arc_offsets);
+  free_slot_index(&digraph->internals->slots);
+  free(digraph->internals);
+  free(digraph);
+}
+
+static void detach_digraph(pgfgd_SyntacticDigraph* d, const pgfgd_DetachedInputs* inputs);
 
-    clear_path(v->path);
-    free(v->path);
-    free(v->name);
-    free(v->shape);
-    free(v->kind);
-    free(v->options);
-    free(v->incoming.array);
-    free(v->outgoing.array);
-    free(v);
+static void run_algorithm(pgfgd_SyntacticDigraph* digraph)
+{
+  double start = pgfgd_clock();
+  digraph->internals->fun(digraph, digraph->internals->user);
+  pgfgd_add_phase_time(digraph, "algorithm", pgfgd_clock() - start);
+}
+
+// Stores the phase times and the sizes of the digraph in the timing
+// field of the algorithm object.
+static void report_timing(lua_State* L, pgfgd_SyntacticDigraph* d, int path_points)
+{
+  pgfgd_SyntacticDigraph_internals* internals = d->internals;
+  int i;
+  
+  lua_createtable(L, 0, internals->timed_phases_length + 3);
+  for (i = 0; i < internals->timed_phases_length; i++) {
+    lua_pushnumber(L, internals->phase_times[i]);
+    lua_setfield(L, -2, internals->timed_phases[i]);
   }
+  lua_pushinteger(L, d->vertices.length);
+  lua_setfield(L, -2, "vertices");
+  lua_pushinteger(L, d->syntactic_edges.length);
+  lua_setfield(L, -2, "edges");
+  lua_pushinteger(L, path_points);
+  lua_setfield(L, -2, "path points");
   
-  for (i=0; i < digraph->syntactic_edges.length; i++) {
-    pgfgd_Edge* e = digraph->syntactic_edges.array[i];
+  lua_setfield(L, ALGORITHM_INDEX, "timing");
+}
+
+// A prepared digraph is handed to Lua in a userdata of this type. Its
+// finalizer frees the digraph unless the results have been written
+// back already, so no digraph is lost when an error is raised before
+// all prepared digraphs have been finished.
+#define PREPARED_DIGRAPH "pgfgd_PreparedDigraph"
 
-    clear_path(e->path);
-    free(e->path);
-    free(e->direction);
-    free(e->options);
-    free(e);
+static int free_prepared_digraph(lua_State* L)
+{
+  pgfgd_SyntacticDigraph** prepared = (pgfgd_SyntacticDigraph**) lua_touserdata(L, 1);
+  if (*prepared)
+    free_digraph(*prepared);
+  *prepared = 0;
+  return 0;
+}
+
+static void push_prepared_digraph(lua_State* L, pgfgd_SyntacticDigraph* digraph)
+{
+  pgfgd_SyntacticDigraph** prepared = (pgfgd_SyntacticDigraph**) lua_newuserdata(L, sizeof(pgfgd_SyntacticDigraph*));
+  *prepared = digraph;
+  if (luaL_newmetatable(L, PREPARED_DIGRAPH)) {
+    lua_pushcfunction(L, free_prepared_digraph);
+    lua_setfield(L, -2, "__gc");
   }
-  
-  free(digraph->vertices.array);
-  free(digraph->syntactic_edges.array);  
-  free(digraph->options);
-  free(digraph->internals);
-  free(digraph);
+  lua_setmetatable(L, -2);
 }
 
+// Returns the prepared digraph at the given index, raising an error
+// if it has been finished already, or 0 if there is none.
+static pgfgd_SyntacticDigraph** to_prepared_digraph(lua_State* L, int index)
+{
+  pgfgd_SyntacticDigraph** prepared = (pgfgd_SyntacticDigraph**) luaL_testudata(L, index, PREPARED_DIGRAPH);
+  if (prepared && !*prepared)
+    luaL_error(L, "the prepared digraph has already been finished");
+  return prepared;
+}
+
+// The dispatcher is called with the parameters explained in
+// InterfaceToC.lua. A detached algorithm may also be run in three
+// steps: When the fifth parameter is true, the digraph is only
+// prepared and returned together with the table of string anchors,
+// which the caller must keep. The prepared digraph is then passed to
+// the run_detached function and, finally, to the dispatcher once
+// more, this time as the fifth parameter with the string anchors as
+// the sixth, so that the results are written back.
 static int algorithm_dispatcher(lua_State* L)
 {
-  // Create the back index table. It will be at index BACKINDEX_STORAGE_INDEX
-  lua_createtable(L, 0, MIN_HASH_SIZE_FIX);
+  pgfgd_SyntacticDigraph** prepared = to_prepared_digraph(L, 5);
+  pgfgd_SyntacticDigraph* digraph = prepared ? *prepared : 0;
+  int prepare = !digraph && lua_toboolean(L, 5);
+
+  if (digraph)
+    lua_settop(L, STRING_ANCHOR_INDEX);
+  else {
+    lua_settop(L, ALGORITHM_INDEX);
+    lua_pushnil(L);
+    
+    // Create the string anchors. They will be at index STRING_ANCHOR_INDEX
+    lua_createtable(L, MIN_HASH_SIZE_FIX, 0);
+  }
   
-  // The actual function is stored in an upvalue.
-  pgfgd_SyntacticDigraph* digraph = (pgfgd_SyntacticDigraph*) calloc(1, sizeof(pgfgd_SyntacticDigraph));
+  // Push the slots of the ugraph. They will be at index SLOTS_INDEX
+  lua_getfield(L, ALGORITHM_INDEX, "ugraph");
+  lua_getfield(L, -1, "slots");
+  lua_replace(L, SLOTS_INDEX);
+  lua_pop(L, 1);
+
+  if (!digraph) {
+    const pgfgd_DetachedInputs* inputs = lua_touserdata(L, lua_upvalueindex(DETACHED_INPUTS_UPVALUE));
+    if (prepare && !inputs)
+      luaL_error(L, "only detached algorithms can be prepared");
+    
+    double start = pgfgd_clock();
+    
+    digraph = (pgfgd_SyntacticDigraph*) calloc(1, sizeof(pgfgd_SyntacticDigraph));
   
-  construct_digraph(L, digraph);
+    construct_digraph(L, digraph);
+
+    // The actual function is stored in an upvalue.
+    digraph->internals->fun  = lua_touserdata(L, lua_upvalueindex(FUNCTION_UPVALUE));
+    digraph->internals->user = lua_touserdata(L, lua_upvalueindex(USER_UPVALUE));
+    
+    // A detached algorithm gets everything it may need up front:
+    if (inputs)
+      detach_digraph(digraph, inputs);
+
+    pgfgd_add_phase_time(digraph, "construct_digraph", pgfgd_clock() - start);
+    
+    if (prepare) {
+      push_prepared_digraph(L, digraph);
+      lua_pushvalue(L, STRING_ANCHOR_INDEX);
+      return 2;
+    }
+    
+    run_algorithm(digraph);
+  }
   
-  pgfgd_algorithm_fun fun = lua_touserdata(L, lua_upvalueindex(FUNCTION_UPVALUE));
-  fun(digraph, lua_touserdata(L, lua_upvalueindex(USER_UPVALUE)));
+  digraph->internals->detached = 0;
 
-  sync_digraph(L, digraph);
+  double start = pgfgd_clock();
+  int path_points = sync_digraph(L, digraph);
+  pgfgd_add_phase_time(digraph, "sync_digraph", pgfgd_clock() - start);
+
+  if (digraph->internals->timing)
+    report_timing(L, digraph, path_points);
   
+  if (prepared)
+    *prepared = 0;
   free_digraph(digraph);
 
   return 0;
 }
 
 
-int pgfgd_vertex_anchor(pgfgd_Vertex* v, const char* anchor, double* x, double* y)
+static void run_algorithms(int from, int to, void* digraphs)
+{
+  int i;
+  for (i = from; i < to; i++)
+    run_algorithm(((pgfgd_SyntacticDigraph**) digraphs)[i]);
+}
+
+// Takes an array of prepared digraphs and runs the algorithm on all
+// of them using pgfgd_parallel_for. Since none of them touches the
+// Lua state and each writes only to its own digraph, the results do
+// not depend on the scheduling.
+static int run_detached(lua_State* L)
+{
+  int i, n = lua_rawlen(L, 1);
+  
+  pgfgd_SyntacticDigraph** digraphs = (pgfgd_SyntacticDigraph**) calloc(n + 1, sizeof(pgfgd_SyntacticDigraph*));
+  for (i = 0; i < n; i++) {
+    lua_rawgeti(L, 1, i+1);
+    pgfgd_SyntacticDigraph** prepared = (pgfgd_SyntacticDigraph**) luaL_testudata(L, -1, PREPARED_DIGRAPH);
+    digraphs[i] = prepared ? *prepared : 0;
+    lua_pop(L, 1);
+    if (!digraphs[i]) {
+      free(digraphs);
+      luaL_error(L, "run_detached expects prepared digraphs");
+    }
+  }
+
+  // All components share the options of the layout:
+  pgfgd_parallel_for(digraphs[0], n, run_algorithms, digraphs);
+  
+  free(digraphs);
+
+  return 0;
+}
+
+
+// Timing
+
+double pgfgd_clock(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void pgfgd_add_phase_time(pgfgd_SyntacticDigraph* g, const char* phase, double seconds)
+{
+  pgfgd_SyntacticDigraph_internals* internals = g->internals;
+  int i;
+
+  for (i = 0; i < internals->timed_phases_length; i++)
+    if (strcmp(internals->timed_phases[i], phase) == 0) {
+      internals->phase_times[i] += seconds;
+      return;
+    }
+  
+  if (i < MAX_TIMED_PHASES) {
+    internals->timed_phases[i] = phase;
+    internals->phase_times[i] = seconds;
+    internals->timed_phases_length++;
+  }
+}
+
+
+
+// Computes an anchor of the vertex on the Lua layer.
+static int lookup_anchor(pgfgd_Vertex* v, pgfgd_key_ref anchor, double* x, double* y)
 {
   lua_State* L = v->options->state;
   
   // Ok, first, find the vertex:
   lua_rawgeti(L, VERTICES_INDEX, v->array_index+1);
 
-  // Find the anchor function:
-  lua_getfield(L, -1, "anchor");
-  lua_pushvalue(L, -2);
-  lua_pushstring(L, anchor);
+  // Anchors like center are normally stored in the anchors table, in
+  // which case we do not need to call the anchor function:
+  lua_getfield(L, -1, "anchors");
+  if (lua_istable(L, -1)) {
+    get_key(L, -1, anchor);
+    lua_replace(L, -2);
+  }
+  
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    
+    // Find the anchor function:
+    lua_getfield(L, -1, "anchor");
+    lua_pushvalue(L, -2);
+    push_key(L, anchor);
 
-  // Find the anchor:
-  lua_call(L, 2, 1);
+    // Find the anchor:
+    lua_call(L, 2, 1);
+  }
 
   if (lua_isnil(L, -1)) {
     // Failed. Cleanup!
@@ -532,7 +1549,193 @@ int pgfgd_vertex_anchor(pgfgd_Vertex* v, const char* anchor, double* x, double*
     lua_pop(L, 2);
     return 1;
   }
-  return 0;
+}
+
+int pgfgd_vertex_anchor_ref(pgfgd_Vertex* v, pgfgd_key_ref anchor, double* x, double* y)
+{
+  // The empty anchor is never found:
+  if (!anchor->name[0]) {
+    *x = 0;
+    *y = 0;
+    return 0;
+  }
+  
+  pgfgd_SyntacticDigraph_internals* internals = v->options->internals;
+  pgfgd_AnchorCache* cache = internals->anchors + v->array_index;
+
+  int i;
+  for (i = 0; i < cache->length; i++)
+    if (cache->entries[i].name == anchor) {
+      *x = cache->entries[i].x;
+      *y = cache->entries[i].y;
+      return cache->entries[i].found;
+    }
+
+  // Not cached, yet. A detached algorithm only gets the anchors
+  // that were extracted beforehand:
+  if (internals->detached) {
+    *x = 0;
+    *y = 0;
+    return 0;
+  }
+  
+  if (cache->length == cache->capacity) {
+    // Grow the cache inside the arena:
+    pgfgd_AnchorEntry* old = cache->entries;
+    cache->capacity = cache->capacity ? 2 * cache->capacity : 2;
+    cache->entries = (pgfgd_AnchorEntry*) arena_alloc(&internals->arena, cache->capacity * sizeof(pgfgd_AnchorEntry));
+    if (old)
+      memcpy(cache->entries, old, cache->length * sizeof(pgfgd_AnchorEntry));
+  }
+
+  pgfgd_AnchorEntry* entry = cache->entries + cache->length++;
+  entry->name  = anchor;
+  entry->found = lookup_anchor(v, anchor, &entry->x, &entry->y);
+
+  *x = entry->x;
+  *y = entry->y;
+  return entry->found;
+}
+
+int pgfgd_vertex_anchor(pgfgd_Vertex* v, const char* anchor, double* x, double* y)
+{
+  return pgfgd_vertex_anchor_ref(v, pgfgd_intern(anchor), x, y);
+}
+
+pgfgd_Path* pgfgd_vertex_path(pgfgd_Vertex* v)
+{
+  if (!v->path) {
+    lua_State* L = v->options->state;
+
+    lua_rawgeti(L, VERTICES_INDEX, v->array_index+1);
+    lua_getfield(L, -1, "path");
+    v->path = make_path(L, &v->options->internals->arena);
+    lua_pop(L, 2);
+  }
+  return v->path;
+}
+
+typedef struct pgfgd_BoundingBox {
+  int    empty;
+  double min_x, min_y, max_x, max_y;
+} pgfgd_BoundingBox;
+
+static void add_to_bbox(pgfgd_BoundingBox* b, double x, double y)
+{
+  if (b->empty) {
+    b->min_x = b->max_x = x;
+    b->min_y = b->max_y = y;
+    b->empty = 0;
+  } else {
+    if (x < b->min_x) b->min_x = x;
+    if (y < b->min_y) b->min_y = y;
+    if (x > b->max_x) b->max_x = x;
+    if (y > b->max_y) b->max_y = y;
+  }
+}
+
+int pgfgd_vertex_bbox(pgfgd_Vertex* v, double* min_x, double* min_y, double* max_x, double* max_y)
+{
+  pgfgd_BoundingBox b = { 1, 0, 0, 0, 0 };
+  int i;
+  
+  if (v->path) {
+    for (i = 0; i < v->path->length; i++)
+      if (!v->path->ops[i])
+	add_to_bbox(&b, v->path->coordinates[i].x, v->path->coordinates[i].y);
+  }
+  else {
+    // Read the coordinates directly from the Lua path:
+    lua_State* L = v->options->state;
+    
+    lua_rawgeti(L, VERTICES_INDEX, v->array_index+1);
+    lua_getfield(L, -1, "path");
+
+    int length = lua_rawlen(L, -1);
+    for (i = 0; i < length; i++) {
+      lua_rawgeti(L, -1, i+1);
+      if (lua_istable(L, -1)) {
+	lua_getfield(L, -1, "x");
+	lua_getfield(L, -2, "y");
+	add_to_bbox(&b, lua_tonumber(L, -2), lua_tonumber(L, -1));
+	lua_pop(L, 2);
+      }
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+  }
+
+  *min_x = b.min_x;
+  *min_y = b.min_y;
+  *max_x = b.max_x;
+  *max_y = b.max_y;
+  
+  return !b.empty;
+}
+
+
+
+// Reading an option for all vertices or edges at once
+
+static void tonumber_array(lua_State* L, int kind, int length, pgfgd_key_ref key, double* out, double fallback)
+{
+  int tos = lua_gettop(L);
+
+  // Push both keys only once:
+  push_key(L, options_key());
+  push_key(L, key);
+
+  int i;
+  for (i = 0; i < length; i++) {
+    lua_rawgeti(L, kind, i+1);
+    lua_pushvalue(L, tos+1);
+    lua_gettable(L, -2);
+    lua_pushvalue(L, tos+2);
+    lua_gettable(L, -2);
+    out[i] = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : fallback;
+    lua_settop(L, tos+2);
+  }
+
+  lua_settop(L, tos);
+}
+
+void pgfgd_vertices_tonumber_array_ref(pgfgd_SyntacticDigraph* g, pgfgd_key_ref key, double* out, double fallback)
+{
+  int i, n = g->vertices.length;
+
+  if (n > 0 && snapshot_value(g->vertices.array[0]->options, key)) {
+    // All vertices have a snapshot of the same keys:
+    for (i = 0; i < n; i++) {
+      const pgfgd_OptionValue* o = snapshot_value(g->vertices.array[i]->options, key);
+      out[i] = o->is_number ? o->number : fallback;
+    }
+  }
+  else
+    tonumber_array(g->internals->state, VERTICES_INDEX, n, key, out, fallback);
+}
+
+void pgfgd_edges_tonumber_array_ref(pgfgd_SyntacticDigraph* g, pgfgd_key_ref key, double* out, double fallback)
+{
+  int i, n = g->syntactic_edges.length;
+
+  if (n > 0 && snapshot_value(g->syntactic_edges.array[0]->options, key)) {
+    for (i = 0; i < n; i++) {
+      const pgfgd_OptionValue* o = snapshot_value(g->syntactic_edges.array[i]->options, key);
+      out[i] = o->is_number ? o->number : fallback;
+    }
+  }
+  else
+    tonumber_array(g->internals->state, EDGES_INDEX, n, key, out, fallback);
+}
+
+void pgfgd_vertices_tonumber_array(pgfgd_SyntacticDigraph* g, const char* key, double* out, double fallback)
+{
+  pgfgd_vertices_tonumber_array_ref(g, pgfgd_intern(key), out, fallback);
+}
+
+void pgfgd_edges_tonumber_array(pgfgd_SyntacticDigraph* g, const char* key, double* out, double fallback)
+{
+  pgfgd_edges_tonumber_array_ref(g, pgfgd_intern(key), out, fallback);
 }
 
 
@@ -542,103 +1745,183 @@ void pgfgd_path_clear(pgfgd_Edge* e)
   clear_path (e->path);
 }
 
-static void path_add_segment(pgfgd_Edge* edge, const char* s, int num, double a, double b, double c, double d, double e, double f)
+static void path_add_segment(pgfgd_Edge* edge, pgfgd_PathOp op, int num, double a, double b, double c, double d, double e, double f)
 {
-  if (edge->path->length == -1)
+  pgfgd_Path* p = edge->path;
+  
+  if (p->length == -1)
     pgfgd_path_clear(edge);
   
-  int start = edge->path->length;
+  int start = p->length;
   
-  edge->path->length += num + 1;
-  edge->path->strings = (char **)
-    realloc(edge->path->strings, edge->path->length*sizeof(char*));
-  edge->path->coordinates = (pgfgd_Coordinate*)
-    realloc(edge->path->coordinates, edge->path->length*sizeof(pgfgd_Coordinate));
+  p->length += num + 1;
+  if (p->length > p->capacity) {
+    // Grow geometrically:
+    p->capacity = p->capacity ? 2 * p->capacity : 8;
+    if (p->capacity < p->length)
+      p->capacity = p->length;
+    p->ops = (unsigned char*)
+      realloc(p->ops, p->capacity*sizeof(unsigned char));
+    p->coordinates = (pgfgd_Coordinate*)
+      realloc(p->coordinates, p->capacity*sizeof(pgfgd_Coordinate));
+  }
   
-  edge->path->coordinates[start].x = 0;
-  edge->path->coordinates[start].y = 0;
-  edge->path->strings[start] = strcpy((char*) malloc(strlen(s)+1), s);
+  p->coordinates[start].x = 0;
+  p->coordinates[start].y = 0;
+  p->ops[start] = op;
   
   if (num > 0) {
-    edge->path->coordinates[start+1].x = a;
-    edge->path->coordinates[start+1].y = b;
-    edge->path->strings[start+1] = 0;
+    p->coordinates[start+1].x = a;
+    p->coordinates[start+1].y = b;
+    p->ops[start+1] = PGFGD_COORDINATE;
   }
 
   if (num > 1) {
-    edge->path->coordinates[start+2].x = c;
-    edge->path->coordinates[start+2].y = d;
-    edge->path->strings[start+2] = 0;
+    p->coordinates[start+2].x = c;
+    p->coordinates[start+2].y = d;
+    p->ops[start+2] = PGFGD_COORDINATE;
   }
 
   if (num > 2) {
-    edge->path->coordinates[start+3].x = e;
-    edge->path->coordinates[start+3].y = f;
-    edge->path->strings[start+3] = 0;
+    p->coordinates[start+3].x = e;
+    p->coordinates[start+3].y = f;
+    p->ops[start+3] = PGFGD_COORDINATE;
   }
 }
 
 
 void pgfgd_path_append_moveto(pgfgd_Edge* e, double x, double y)
 {
-  path_add_segment(e, "moveto", 1, x, y, 0, 0, 0, 0);
+  path_add_segment(e, PGFGD_MOVETO, 1, x, y, 0, 0, 0, 0);
+}
+
+static pgfgd_key_ref tail_anchor_key(void)
+{
+  static pgfgd_key_ref k;
+  if (!k)
+    k = pgfgd_intern("tail anchor");
+  return k;
+}
+
+static pgfgd_key_ref head_anchor_key(void)
+{
+  static pgfgd_key_ref k;
+  if (!k)
+    k = pgfgd_intern("head anchor");
+  return k;
+}
+
+static pgfgd_key_ref center_anchor_key(void)
+{
+  static pgfgd_key_ref k;
+  if (!k)
+    k = pgfgd_intern("center");
+  return k;
+}
+
+// Returns the interned anchor stored in the given option of an
+// edge. Like Edge:tailAnchorForEdgePath, the empty anchor is taken
+// to be the center:
+static pgfgd_key_ref anchor_option(pgfgd_Edge* e, pgfgd_key_ref key)
+{
+  const char* anchor = pgfgd_tostring_view_ref(e->options, key, 0);
+  return anchor && anchor[0] ? pgfgd_intern(anchor) : center_anchor_key();
 }
 
 void pgfgd_path_append_moveto_tail (pgfgd_Edge* e)
 {
-  double x, y;
-  char* tail_anchor = pgfgd_tostring(e->tail->options, "tail anchor");
-  
-  pgfgd_vertex_anchor(e->tail, tail_anchor, &x, &y);
-  x += e->tail->pos.x;
-  y += e->tail->pos.y;
+  double x, y, vx, vy;
+  pgfgd_vertex_anchor_ref(e->tail, anchor_option(e, tail_anchor_key()), &x, &y);
+  vertex_position(e->tail, &vx, &vy);
+  x += vx;
+  y += vy;
 
   pgfgd_path_append_moveto(e, x, y);
-  free(tail_anchor);
 }
 
 void pgfgd_path_append_lineto(pgfgd_Edge* e, double x, double y)
 {
-  path_add_segment(e, "lineto", 1, x, y, 0, 0, 0, 0);
+  path_add_segment(e, PGFGD_LINETO, 1, x, y, 0, 0, 0, 0);
 }
 
 void pgfgd_path_append_lineto_head (pgfgd_Edge* e)
 {
-  double x, y;
-  char* head_anchor = pgfgd_tostring(e->head->options, "head anchor");
-  
-  pgfgd_vertex_anchor(e->head, head_anchor, &x, &y);
-  x += e->head->pos.x;
-  y += e->head->pos.y;
+  double x, y, vx, vy;
+  pgfgd_vertex_anchor_ref(e->head, anchor_option(e, head_anchor_key()), &x, &y);
+  vertex_position(e->head, &vx, &vy);
+  x += vx;
+  y += vy;
 
   pgfgd_path_append_lineto(e, x, y);
-  free(head_anchor);
 }
 
 void pgfgd_path_append_curveto(pgfgd_Edge* edge, double a, double b, double c, double d, double e, double f)
 {
-  path_add_segment(edge, "curveto", 3, a, b, c, d, e, f);
+  path_add_segment(edge, PGFGD_CURVETO, 3, a, b, c, d, e, f);
 }
 
 void pgfgd_path_append_closepath(pgfgd_Edge* e)
 {
-  path_add_segment(e, "closepath", 0, 0, 0, 0, 0, 0, 0);
+  path_add_segment(e, PGFGD_CLOSEPATH, 0, 0, 0, 0, 0, 0, 0);
 }
 
 
 
 // Handling digraphs
 
+// An entry of the open addressing hash table of the arcs of a
+// digraph. The arc field is the position of the arc in the out_heads
+// array of the digraph's csr; a tail of 0 marks an empty slot.
+typedef struct pgfgd_ArcSlot {
+  int tail;
+  int head;
+  int arc;
+} pgfgd_ArcSlot;
+
 struct pgfgd_Digraph {
   lua_State* state;
   const char* name;
   pgfgd_SyntacticDigraph* syntactic_digraph;
+
+  // Computed on demand by pgfgd_digraph_csr:
+  pgfgd_Digraph_csr* csr;
+
+  // Computed on demand by pgfgd_digraph_all_syntactic_edges:
+  pgfgd_Digraph_syntactic_edges* syntactic_edges;
+
+  // Computed on demand by arc_lookup:
+  pgfgd_ArcSlot* arc_slots;
+  unsigned int   arc_slots_mask;
+
+  // Used by vertex_slot for the vertices of the digraph:
+  pgfgd_SlotIndex slots;
+
+  // Only set for the digraphs extracted for a detached algorithm,
+  // see detach_digraph:
+  pgfgd_Arc_array* arcs;
+  pgfgd_Vertex**   syntactic_vertices;
+
+  // Set for the handles that a detached algorithm gets. They share
+  // all of the above with an extracted digraph:
+  int borrowed;
 };
 
 
 pgfgd_Digraph* pgfgd_get_digraph (pgfgd_SyntacticDigraph* g, const char* graph_name)
 {
   lua_State* L = g->internals->state;
+
+  if (g->internals->detached) {
+    int i;
+    for (i = 0; i < g->internals->digraphs_length; i++)
+      if (strcmp(g->internals->digraphs[i]->name, graph_name) == 0) {
+	pgfgd_Digraph* new = (pgfgd_Digraph*) malloc(sizeof(pgfgd_Digraph));
+	*new = *g->internals->digraphs[i];
+	new->borrowed = 1;
+	return new;
+      }
+    return 0;
+  }
   
   lua_getfield(L, ALGORITHM_INDEX, graph_name);
   if (lua_isnil(L, -1)) 
@@ -656,6 +1939,9 @@ pgfgd_Digraph* pgfgd_get_digraph (pgfgd_SyntacticDigraph* g, const char* graph_n
 
 int pgfgd_digraph_num_vertices (pgfgd_Digraph* g)
 {
+  if (g->syntactic_vertices)
+    return g->csr->num_vertices;
+  
   lua_getfield(g->state, ALGORITHM_INDEX, g->name);
   lua_getfield(g->state, -1, "vertices");
   int num = lua_rawlen(g->state, -1);
@@ -664,40 +1950,14 @@ int pgfgd_digraph_num_vertices (pgfgd_Digraph* g)
   return num;
 }
 
-static void push_digraph_and_backindex(pgfgd_Digraph* g)
+// Pushes the digraph, its vertices array, and its slots table.
+static void push_digraph_and_slots(pgfgd_Digraph* g)
 {
   lua_State* L = g->state;
   
-  // Get digraph
   lua_getfield(L, ALGORITHM_INDEX, g->name);
-  int digraph_pos = lua_gettop(L);
-  
-  // Get entry in back index table
-  lua_pushvalue(L, digraph_pos);    
-  lua_gettable(L, BACKINDEX_STORAGE_INDEX);
-  int backtable_pos = lua_gettop(L);
-  if (lua_isnil(L, backtable_pos)) {
-    // Aha. We need to install a new table:
-    lua_pop(L, 1); // Get rid of nil
-
-    lua_createtable(L, 0, MIN_HASH_SIZE_FIX);
-    
-    lua_pushvalue(L, digraph_pos); // The digraph object
-    lua_pushvalue(L, backtable_pos); // The new table
-    lua_settable(L, BACKINDEX_STORAGE_INDEX);
-
-    // Fill the table:
-    lua_getfield(L, digraph_pos, "vertices");
-    int vertex_pos = lua_gettop(L);
-    int i;
-    int n = lua_rawlen(L, -1);
-    for (i = 1; i <= n; i++) {
-      lua_rawgeti(L, vertex_pos, i);
-      lua_pushinteger(L, i);
-      lua_settable(L, backtable_pos);
-    }
-    lua_pop(L, 1);
-  }
+  lua_getfield(L, -1, "vertices");
+  lua_getfield(L, -2, "slots");
 }
 
 static pgfgd_Arc_array* build_c_array_of_arcs_from_lua_array_of_arcs(pgfgd_Digraph* g)
@@ -708,8 +1968,9 @@ static pgfgd_Arc_array* build_c_array_of_arcs_from_lua_array_of_arcs(pgfgd_Digra
   
   int array_pos = lua_gettop(L);
   
-  push_digraph_and_backindex(g);
-  int backtable_pos = lua_gettop(L);  
+  push_digraph_and_slots(g);
+  int slots_pos = lua_gettop(L);
+  int vertices_pos = slots_pos - 1;
 
   // Get number of arcs:
   init_arcs_array(arcs, lua_rawlen(L, array_pos));
@@ -719,16 +1980,11 @@ static pgfgd_Arc_array* build_c_array_of_arcs_from_lua_array_of_arcs(pgfgd_Digra
     
     // The tail field:
     lua_getfield(L, -1, "tail");
-    lua_gettable(L, backtable_pos);
-    
-    arcs->tails[i-1] = lua_tointeger(L, -1);
-    lua_pop(L, 1); // The number
+    arcs->tails[i-1] = vertex_slot(L, vertices_pos, slots_pos, &g->slots);
     
     // The head field:
     lua_getfield(L, -1, "head");
-    lua_gettable(L, backtable_pos);
-    arcs->heads[i-1] = lua_tointeger(L, -1);
-    lua_pop(L, 1); // The number
+    arcs->heads[i-1] = vertex_slot(L, vertices_pos, slots_pos, &g->slots);
     
     lua_pop(L, 1); // Pop arcs[i]
   }
@@ -741,6 +1997,14 @@ static pgfgd_Arc_array* build_c_array_of_arcs_from_lua_array_of_arcs(pgfgd_Digra
 
 pgfgd_Arc_array* pgfgd_digraph_arcs (pgfgd_Digraph* g)
 {
+  if (g->arcs) {
+    pgfgd_Arc_array* a = (pgfgd_Arc_array*) calloc(1, sizeof(pgfgd_Arc_array));
+    init_arcs_array(a, g->arcs->length);
+    memcpy(a->tails, g->arcs->tails, a->length * sizeof(int));
+    memcpy(a->heads, g->arcs->heads, a->length * sizeof(int));
+    return a;
+  }
+  
   lua_getfield(g->state, ALGORITHM_INDEX, g->name);
   lua_getfield(g->state, -1, "arcs");
 
@@ -754,6 +2018,9 @@ pgfgd_Arc_array* pgfgd_digraph_arcs (pgfgd_Digraph* g)
 
 pgfgd_Vertex* pgfgd_digraph_syntactic_vertex (pgfgd_Digraph* g, int v)
 {
+  if (g->syntactic_vertices)
+    return (v >= 1 && v <= g->csr->num_vertices) ? g->syntactic_vertices[v-1] : 0;
+  
   int tos = lua_gettop(g->state);
   pgfgd_Vertex* return_me = 0;
   
@@ -761,44 +2028,89 @@ pgfgd_Vertex* pgfgd_digraph_syntactic_vertex (pgfgd_Digraph* g, int v)
   lua_getfield(g->state, -1, "vertices");
   lua_rawgeti(g->state, -1, v);
   
-  lua_gettable(g->state, VERTICES_INDEX);
-  if (lua_isnumber(g->state, -1)) {
-    return_me = g->syntactic_digraph->vertices.array[lua_tointeger(g->state, -1)-1];
-  }
+  int slot = vertex_slot(g->state, VERTICES_INDEX, SLOTS_INDEX, &g->syntactic_digraph->internals->slots);
+  if (slot)
+    return_me = g->syntactic_digraph->vertices.array[slot-1];
   
   lua_settop(g->state, tos);
   return return_me;
 }
 
 
-int pgfgd_digraph_isarc (pgfgd_Digraph* g, int tail, int head)
+static unsigned int hash_arc(int tail, int head)
 {
-  lua_State* L = g->state;
-  int is_arc = 0;
-  
-  lua_getfield(L, ALGORITHM_INDEX, g->name);
-  int digraph_pos = lua_gettop(L);
-  
-  lua_getfield(L, digraph_pos, "vertices");
-  int vertices_pos = lua_gettop(L);
+  return ((unsigned int) tail * 0x9E3779B1u) ^ ((unsigned int) head * 0x85EBCA77u);
+}
 
-  // Call digraph:connected(tail, head)
-  lua_pushvalue(L, lua_upvalueindex(DIGRAPH_OBJECT_UPVALUE));
-  lua_getfield(L, -1, "arc");
-  lua_pushvalue(L, digraph_pos);
-  lua_rawgeti(L, vertices_pos, tail);
-  lua_rawgeti(L, vertices_pos, head);
-  lua_call(L, 3, 1);
+// Returns the position of the arc from tail to head in the out_heads
+// array of the digraph's csr or -1 if there is no such arc. The hash
+// table of all arcs is built on the first call.
+static int arc_lookup(pgfgd_Digraph* g, int tail, int head)
+{
+  if (!g->arc_slots) {
+    const pgfgd_Digraph_csr* csr = pgfgd_digraph_csr(g);
+
+    // Keep the load factor at most 1/2:
+    unsigned int size = 16;
+    while (size < 2 * (unsigned int) csr->num_arcs)
+      size *= 2;
+    g->arc_slots = (pgfgd_ArcSlot*) calloc(size, sizeof(pgfgd_ArcSlot));
+    g->arc_slots_mask = size - 1;
+
+    int v, p;
+    for (v = 1; v <= csr->num_vertices; v++)
+      for (p = csr->out_offsets[v-1]; p < csr->out_offsets[v]; p++) {
+	unsigned int i = hash_arc(v, csr->out_heads[p]) & g->arc_slots_mask;
+	while (g->arc_slots[i].tail)
+	  i = (i+1) & g->arc_slots_mask;
+	g->arc_slots[i].tail = v;
+	g->arc_slots[i].head = csr->out_heads[p];
+	g->arc_slots[i].arc  = p;
+      }
+  }
+
+  unsigned int i = hash_arc(tail, head) & g->arc_slots_mask;
+  while (g->arc_slots[i].tail) {
+    if (g->arc_slots[i].tail == tail && g->arc_slots[i].head == head)
+      return g->arc_slots[i].arc;
+    i = (i+1) & g->arc_slots_mask;
+  }
   
-  is_arc = !lua_isnil(L, -1);
+  return -1;
+}
 
-  lua_settop(L, digraph_pos-1);
+int pgfgd_digraph_isarc (pgfgd_Digraph* g, int tail, int head)
+{
+  return arc_lookup(g, tail, head) >= 0;
+}
+
+// Returns the arcs of a vertex from the csr of a digraph. The ends
+// array holds the other ends of the arcs.
+static pgfgd_Arc_array* csr_arcs(const int* offsets, const int* ends, int v, int n, int incoming)
+{
+  pgfgd_Arc_array* a = (pgfgd_Arc_array*) calloc(1, sizeof(pgfgd_Arc_array));
+
+  if (v < 1 || v > n) {
+    init_arcs_array(a, 0);
+    return a;
+  }
+  
+  init_arcs_array(a, offsets[v] - offsets[v-1]);
+  int i;
+  for (i = 0; i < a->length; i++) {
+    int other = ends[offsets[v-1] + i];
+    a->tails[i] = incoming ? other : v;
+    a->heads[i] = incoming ? v : other;
+  }
   
-  return is_arc;
+  return a;
 }
 
 pgfgd_Arc_array* pgfgd_digraph_incoming (pgfgd_Digraph* g, int v)
 {
+  if (g->syntactic_vertices)
+    return csr_arcs(g->csr->in_offsets, g->csr->in_tails, v, g->csr->num_vertices, 1);
+  
   lua_State* L = g->state;
   
   lua_getfield(L, ALGORITHM_INDEX, g->name);
@@ -823,6 +2135,9 @@ pgfgd_Arc_array* pgfgd_digraph_incoming (pgfgd_Digraph* g, int v)
 
 pgfgd_Arc_array* pgfgd_digraph_outgoing (pgfgd_Digraph* g, int v)
 {
+  if (g->syntactic_vertices)
+    return csr_arcs(g->csr->out_offsets, g->csr->out_heads, v, g->csr->num_vertices, 0);
+  
   lua_State* L = g->state;
   
   lua_getfield(L, ALGORITHM_INDEX, g->name);
@@ -845,62 +2160,233 @@ pgfgd_Arc_array* pgfgd_digraph_outgoing (pgfgd_Digraph* g, int v)
   return a;  
 }
 
-pgfgd_Edge_array* pgfgd_digraph_syntactic_edges  (pgfgd_Digraph* g, int tail, int head)
+// Appends the numbers of the vertices stored in field (head or tail) of
+// the arcs in the Lua array on top of the stack to the array
+// *entries and returns the new length.
+static int append_arc_ends(lua_State* L, int vertices_pos, int slots_pos, pgfgd_SlotIndex* index, const char* field, int** entries, int length, int* capacity)
 {
-  pgfgd_Edge_array* edges = (pgfgd_Edge_array*) calloc(1, sizeof(pgfgd_Edge_array));
+  int n = lua_rawlen(L, -1);
+  if (length + n > *capacity) {
+    while (length + n > *capacity)
+      *capacity = *capacity ? 2 * *capacity : 16;
+    *entries = (int*) realloc(*entries, *capacity * sizeof(int));
+  }
+
+  int i;
+  for (i = 1; i <= n; i++) {
+    lua_rawgeti(L, -1, i);
+    lua_getfield(L, -1, field);
+    (*entries)[length++] = vertex_slot(L, vertices_pos, slots_pos, index);
+    lua_pop(L, 1);
+  }
 
-  // First, get the arc in the syntactic digraph.
+  return length;
+}
+
+const pgfgd_Digraph_csr* pgfgd_digraph_csr (pgfgd_Digraph* g)
+{
+  if (g->csr)
+    return g->csr;
+  
   lua_State* L = g->state;
   int tos = lua_gettop(L);
+
+  push_digraph_and_slots(g);
+  int digraph_pos = tos + 1;
+  int vertices_pos = tos + 2;
+  int slots_pos = tos + 3;
+
+  pgfgd_Digraph_csr* csr = (pgfgd_Digraph_csr*) calloc(1, sizeof(pgfgd_Digraph_csr));
+  int n = lua_rawlen(L, vertices_pos);
+  
+  csr->num_vertices = n;
+  csr->out_offsets  = (int*) calloc(n+1, sizeof(int));
+  csr->in_offsets   = (int*) calloc(n+1, sizeof(int));
+
+  // A single pass over the vertices, reading the arrays
+  // v.outgoings[digraph] and v.incomings[digraph]:
+  int out_length = 0, out_capacity = 0;
+  int in_length = 0, in_capacity = 0;
+  int v;
+  for (v = 1; v <= n; v++) {
+    lua_rawgeti(L, vertices_pos, v);
+    
+    lua_getfield(L, -1, "outgoings");
+    lua_pushvalue(L, digraph_pos);
+    lua_gettable(L, -2);
+    out_length = append_arc_ends(L, vertices_pos, slots_pos, &g->slots, "head", &csr->out_heads, out_length, &out_capacity);
+    lua_pop(L, 2);
+    
+    lua_getfield(L, -1, "incomings");
+    lua_pushvalue(L, digraph_pos);
+    lua_gettable(L, -2);
+    in_length = append_arc_ends(L, vertices_pos, slots_pos, &g->slots, "tail", &csr->in_tails, in_length, &in_capacity);
+    lua_pop(L, 3);
+
+    csr->out_offsets[v] = out_length;
+    csr->in_offsets[v] = in_length;
+  }
+  
+  csr->num_arcs = out_length;
+  
+  lua_settop(L, tos);
+
+  g->csr = csr;
+  return csr;
+}
+
+
+// The syntactic edges at EDGES_INDEX are the syntactic edges of the
+// arcs of the layout graph that connect the vertices of the ugraph,
+// collected in the order of the ugraph's arcs. This function returns
+// an array that maps the slot of each arc of the layout graph to the
+// position of the arc's first edge in the syntactic edges, or -1 if
+// the arc has not been visited.
+static const int* syntactic_arc_offsets(pgfgd_SyntacticDigraph* d)
+{
+  pgfgd_SyntacticDigraph_internals* internals = d->internals;
+  
+  if (!internals->arc_offsets) {
+    lua_State* L = internals->state;
+    int tos = lua_gettop(L);
+    
+    lua_getfield(L, ALGORITHM_INDEX, "layout_graph");
+    int layout_pos = lua_gettop(L);
+    
+    lua_getfield(L, layout_pos, "arc_slots");
+    int n = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+
+    internals->arc_offsets_length = n + 1;
+    internals->arc_offsets = (int*) malloc((n + 1) * sizeof(int));
+    int i;
+    for (i = 0; i <= n; i++)
+      internals->arc_offsets[i] = -1;
+    
+    lua_getfield(L, ALGORITHM_INDEX, "ugraph");
+    lua_getfield(L, -1, "arcs");
+    int arcs_pos = lua_gettop(L);
+
+    int offset = 0;
+    int m = lua_rawlen(L, arcs_pos);
+    for (i = 1; i <= m; i++) {
+      lua_rawgeti(L, arcs_pos, i);
+      int arc_pos = lua_gettop(L);
+
+      // This does what layout_graph:arc(tail, head) does:
+      lua_getfield(L, arc_pos, "tail");
+      lua_getfield(L, -1, "outgoings");
+      lua_pushvalue(L, layout_pos);
+      lua_gettable(L, -2);
+      if (lua_istable(L, -1)) {
+	lua_getfield(L, arc_pos, "head");
+	lua_gettable(L, -2);
+	if (lua_istable(L, -1)) {
+	  lua_getfield(L, -1, "slot");
+	  int slot = lua_tointeger(L, -1);
+	  lua_getfield(L, -2, "syntactic_edges");
+	  if (slot > 0 && slot <= n)
+	    internals->arc_offsets[slot] = offset;
+	  offset += lua_rawlen(L, -1);
+	}
+      }
+
+      lua_settop(L, arcs_pos);
+    }
+    
+    lua_settop(L, tos);
+  }
   
+  return internals->arc_offsets;
+}
+
+const pgfgd_Digraph_syntactic_edges* pgfgd_digraph_all_syntactic_edges (pgfgd_Digraph* g)
+{
+  if (g->syntactic_edges)
+    return g->syntactic_edges;
+
+  // The arcs are numbered as in the csr:
+  const pgfgd_Digraph_csr* csr = pgfgd_digraph_csr(g);
+  const int* offsets = syntactic_arc_offsets(g->syntactic_digraph);
+  int offsets_length = g->syntactic_digraph->internals->arc_offsets_length;
+  const pgfgd_Edge_array* edges = &g->syntactic_digraph->syntactic_edges;
+  
+  lua_State* L = g->state;
+  int tos = lua_gettop(L);
+
   lua_getfield(L, ALGORITHM_INDEX, g->name);
   int digraph_pos = lua_gettop(L);
   
   lua_getfield(L, digraph_pos, "vertices");
   int vertices_pos = lua_gettop(L);
 
-  // Call digraph:arc(tail, head)
-  lua_pushvalue(L, lua_upvalueindex(DIGRAPH_OBJECT_UPVALUE));
-  int digraph_class_index = lua_gettop(L);
+  lua_getfield(L, ALGORITHM_INDEX, "layout_graph");
+  int layout_pos = lua_gettop(L);
   
-  lua_getfield(L, digraph_class_index, "arc");
-  lua_pushvalue(L, digraph_pos);
-  lua_rawgeti(L, vertices_pos, tail);
-  lua_rawgeti(L, vertices_pos, head);
-  lua_call(L, 3, 1);
-
-  if (!lua_isnil(L, -1)) {
-    // Get syntactic_digraph of the arc:
-    lua_getfield(L, -1, "syntactic_digraph");
-
-    // Call syntactic_digraph:arc(tail, head)
-    lua_getfield(L, digraph_class_index, "arc");
-    lua_pushvalue(L, -2);
-    lua_rawgeti(L, vertices_pos, tail);
-    lua_rawgeti(L, vertices_pos, head);
-    lua_call(L, 3, 1);
-
-    if (!lua_isnil(L, -1)) {
-      lua_getfield(L, -1, "syntactic_edges");
-      int syntactic_edges_index = lua_gettop(L);
-      
-      int n = lua_rawlen(L, syntactic_edges_index);
-      init_edge_array(edges, n);
-      int i;
-      for (i=1; i<=n; i++) {
-	lua_rawgeti(L, syntactic_edges_index, i);
-	lua_gettable(L, EDGES_INDEX);
-	if (!lua_isnumber(L, -1)) {
-	  pgfgd_digraph_free_edge_array(edges);
-	  luaL_error(L, "syntactic edge index not found");
+  pgfgd_Digraph_syntactic_edges* se = (pgfgd_Digraph_syntactic_edges*) calloc(1, sizeof(pgfgd_Digraph_syntactic_edges));
+  se->num_arcs = csr->num_arcs;
+  se->arcs = (pgfgd_Edge_array*) calloc(csr->num_arcs ? csr->num_arcs : 1, sizeof(pgfgd_Edge_array));
+  
+  int arc = 0;
+  int v;
+  for (v = 1; v <= csr->num_vertices; v++) {
+    lua_rawgeti(L, vertices_pos, v);
+    int vertex_pos = lua_gettop(L);
+    
+    lua_getfield(L, vertex_pos, "outgoings");
+    lua_pushvalue(L, digraph_pos);
+    lua_gettable(L, -2);
+    int outgoings_pos = lua_gettop(L);
+
+    // The outgoing arcs of the vertex in the layout graph:
+    lua_getfield(L, vertex_pos, "outgoings");
+    lua_pushvalue(L, layout_pos);
+    lua_gettable(L, -2);
+    int layout_outgoings_pos = lua_gettop(L);
+    
+    int n = lua_rawlen(L, outgoings_pos);
+    int i;
+    for (i = 1; i <= n && lua_istable(L, layout_outgoings_pos); i++) {
+      lua_rawgeti(L, outgoings_pos, i);
+      lua_getfield(L, -1, "head");
+      lua_gettable(L, layout_outgoings_pos);
+      if (lua_istable(L, -1)) {
+	lua_getfield(L, -1, "slot");
+	int slot = lua_tointeger(L, -1);
+	lua_getfield(L, -2, "syntactic_edges");
+	int m = lua_rawlen(L, -1);
+
+	if (m > 0) {
+	  if (slot <= 0 || slot >= offsets_length || offsets[slot] < 0 || offsets[slot] + m > edges->length)
+	    luaL_error(L, "syntactic edge index not found");
+	  se->arcs[arc + i - 1].length = m;
+	  se->arcs[arc + i - 1].array  = edges->array + offsets[slot];
 	}
-	int p = lua_tonumber(L, -1);
-	edges->array[i-1] = g->syntactic_digraph->syntactic_edges.array[p-1];
       }
-    }      
+      lua_settop(L, layout_outgoings_pos);
+    }
+    
+    arc += n;
+    lua_settop(L, layout_pos);
   }
 
   lua_settop(L, tos);
+
+  g->syntactic_edges = se;
+  return se;
+}
+
+
+pgfgd_Edge_array* pgfgd_digraph_syntactic_edges  (pgfgd_Digraph* g, int tail, int head)
+{
+  pgfgd_Edge_array* edges = (pgfgd_Edge_array*) calloc(1, sizeof(pgfgd_Edge_array));
+
+  int arc = arc_lookup(g, tail, head);
+  if (arc >= 0) {
+    const pgfgd_Edge_array* slice = &pgfgd_digraph_all_syntactic_edges(g)->arcs[arc];
+    init_edge_array(edges, slice->length);
+    memcpy(edges->array, slice->array, slice->length * sizeof(pgfgd_Edge*));
+  }
   
   return edges;
 }
@@ -909,6 +2395,27 @@ pgfgd_Edge_array* pgfgd_digraph_syntactic_edges  (pgfgd_Digraph* g, int tail, in
 
 void pgfgd_digraph_free (pgfgd_Digraph* g)
 {
+  if (g->borrowed) {
+    free(g);
+    return;
+  }
+  
+  if (g->csr) {
+    free(g->csr->out_offsets);
+    free(g->csr->out_heads);
+    free(g->csr->in_offsets);
+    free(g->csr->in_tails);
+    free(g->csr);
+  }
+  if (g->syntactic_edges) {
+    free(g->syntactic_edges->arcs);
+    free(g->syntactic_edges);
+  }
+  free(g->arc_slots);
+  free_slot_index(&g->slots);
+  if (g->arcs)
+    pgfgd_digraph_free_arc_array(g->arcs);
+  free(g->syntactic_vertices);
   free(g);
 }
 
@@ -926,6 +2433,299 @@ void pgfgd_digraph_free_edge_array (pgfgd_Edge_array* edges)
 }
 
 
+// Extracts everything from Lua that a detached algorithm may need:
+// The paths of all vertices, the declared anchors of all vertices and
+// the anchors that the edges start and end at, and the declared
+// digraphs together with everything that can be queried about them.
+static void detach_digraph(pgfgd_SyntacticDigraph* d, const pgfgd_DetachedInputs* inputs)
+{
+  pgfgd_SyntacticDigraph_internals* internals = d->internals;
+  double x, y;
+  int i, j;
+
+  for (i = 0; i < d->vertices.length; i++) {
+    pgfgd_Vertex* v = d->vertices.array[i];
+    
+    pgfgd_vertex_path(v);
+    for (j = 0; j < inputs->anchors_length; j++)
+      pgfgd_vertex_anchor_ref(v, inputs->anchors[j], &x, &y);
+  }
+
+  for (i = 0; i < d->syntactic_edges.length; i++) {
+    pgfgd_Edge* e = d->syntactic_edges.array[i];
+    
+    pgfgd_vertex_anchor_ref(e->tail, anchor_option(e, tail_anchor_key()), &x, &y);
+    pgfgd_vertex_anchor_ref(e->head, anchor_option(e, head_anchor_key()), &x, &y);
+  }
+
+  internals->digraphs_length = inputs->digraphs_length;
+  internals->digraphs = (pgfgd_Digraph**) calloc(inputs->digraphs_length, sizeof(pgfgd_Digraph*));
+  
+  for (i = 0; i < inputs->digraphs_length; i++) {
+    pgfgd_Digraph* g = pgfgd_get_digraph(d, pgfgd_key_name(inputs->digraphs[i]));
+
+    const pgfgd_Digraph_csr* csr = pgfgd_digraph_csr(g);
+    pgfgd_digraph_all_syntactic_edges(g);
+    arc_lookup(g, 0, 0); // Builds the hash table of the arcs
+    g->arcs = pgfgd_digraph_arcs(g);
+
+    pgfgd_Vertex** syntactic_vertices = (pgfgd_Vertex**) calloc(csr->num_vertices + 1, sizeof(pgfgd_Vertex*));
+    for (j = 0; j < csr->num_vertices; j++)
+      syntactic_vertices[j] = pgfgd_digraph_syntactic_vertex(g, j+1);
+    g->syntactic_vertices = syntactic_vertices;
+
+    internals->digraphs[i] = g;
+  }
+  
+  internals->detached = 1;
+}
+
+
+
+// Running code in parallel
+//
+// All parallel work of a library is done by a single pool of worker
+// threads, which is created on first use and grows up to the largest
+// number of threads requested. The workers live as long as the Lua
+// state that the library's algorithms were declared in: when it is
+// closed, and before the library is unloaded, they are shut down and
+// joined. A pgfgd_parallel_for splits its range into
+// chunks and deals out contiguous runs of chunks to the participating
+// threads, the calling thread being one of them. A thread that has
+// finished its own run steals chunks from the ends of the runs of the
+// others.
+
+#ifdef PGFGD_THREADS
+
+#define PARALLEL_MAX_THREADS 256
+#define PARALLEL_CHUNKS_PER_THREAD 8
+
+typedef struct pgfgd_ParallelRun {
+  pthread_mutex_t lock;
+  int             next;
+  int             end;
+} pgfgd_ParallelRun;
+
+typedef struct pgfgd_ParallelJob {
+  pgfgd_parallel_fun fun;
+  void*              user_data;
+  int                n;
+  int                grain;
+
+  int                participants;
+  pgfgd_ParallelRun* runs;
+
+  // The number of workers that have joined and left the job:
+  int                joined;
+  int                left;
+} pgfgd_ParallelJob;
+
+static struct {
+  pthread_mutex_t    lock;
+  pthread_cond_t     job_posted;
+  pthread_cond_t     worker_left;
+  int                workers;
+  pthread_t          threads[PARALLEL_MAX_THREADS];
+  pgfgd_ParallelJob* job;
+  unsigned long      generation;
+  int                shutdown;
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, { 0 }, 0, 0, 0 };
+
+
+// Returns the next chunk of the run from its front or its back, or
+// -1 if the run is empty.
+static int take_chunk(pgfgd_ParallelRun* r, int from_back)
+{
+  int chunk = -1;
+  
+  pthread_mutex_lock(&r->lock);
+  if (r->next < r->end)
+    chunk = from_back ? --r->end : r->next++;
+  pthread_mutex_unlock(&r->lock);
+
+  return chunk;
+}
+
+static void do_chunk(pgfgd_ParallelJob* job, int chunk)
+{
+  int from = chunk * job->grain;
+  int to = from + job->grain < job->n ? from + job->grain : job->n;
+  job->fun(from, to, job->user_data);
+}
+
+static void parallel_work(pgfgd_ParallelJob* job, int participant)
+{
+  int chunk, i;
+  
+  while ((chunk = take_chunk(job->runs + participant, 0)) >= 0)
+    do_chunk(job, chunk);
+
+  for (i = 1; i < job->participants; i++) {
+    pgfgd_ParallelRun* victim = job->runs + (participant + i) % job->participants;
+    while ((chunk = take_chunk(victim, 1)) >= 0)
+      do_chunk(job, chunk);
+  }
+}
+
+static void* parallel_worker(void* unused)
+{
+  unsigned long seen = 0;
+  (void) unused;
+  
+  pthread_mutex_lock(&pool.lock);
+  for (;;) {
+    while (!pool.shutdown && (!pool.job || pool.generation == seen))
+      pthread_cond_wait(&pool.job_posted, &pool.lock);
+    if (pool.shutdown)
+      break;
+    seen = pool.generation;
+
+    pgfgd_ParallelJob* job = pool.job;
+    if (job->joined < job->participants - 1) {
+      int participant = ++job->joined;
+      
+      pthread_mutex_unlock(&pool.lock);
+      parallel_work(job, participant);
+      pthread_mutex_lock(&pool.lock);
+      
+      job->left++;
+      pthread_cond_signal(&pool.worker_left);
+    }
+  }
+  pthread_mutex_unlock(&pool.lock);
+  
+  return 0;
+}
+
+static int shutdown_pool(lua_State* L)
+{
+  int i;
+  (void) L;
+  
+  pthread_mutex_lock(&pool.lock);
+  pool.shutdown = 1;
+  pthread_cond_broadcast(&pool.job_posted);
+  pthread_mutex_unlock(&pool.lock);
+
+  for (i = 0; i < pool.workers; i++)
+    pthread_join(pool.threads[i], 0);
+  
+  pool.workers = 0;
+  pool.shutdown = 0;
+  
+  return 0;
+}
+
+// Makes sure that the pool is shut down when the Lua state is
+// closed. Since the finalizer is created after the library has been
+// loaded, it runs before the library is unloaded.
+static void register_pool_shutdown(lua_State* L)
+{
+  lua_pushlightuserdata(L, &pool);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  if (lua_isnil(L, -1)) {
+    lua_pushlightuserdata(L, &pool);
+    lua_newuserdata(L, 1);
+    lua_createtable(L, 0, 1);
+    lua_pushcfunction(L, shutdown_pool);
+    lua_setfield(L, -2, "__gc");
+    lua_setmetatable(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+  }
+  lua_pop(L, 1);
+}
+
+void pgfgd_parallel_for(pgfgd_SyntacticDigraph* g, int n, pgfgd_parallel_fun f, void* user_data)
+{
+  if (n <= 0)
+    return;
+  
+  int threads = g ? g->internals->threads : 0;
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads <= 0)
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (threads > PARALLEL_MAX_THREADS)
+    threads = PARALLEL_MAX_THREADS;
+  if (threads > n)
+    threads = n;
+
+  pthread_mutex_lock(&pool.lock);
+  
+  // Nested calls and calls while the pool is busy otherwise are run
+  // by the calling thread alone:
+  if (threads <= 1 || pool.job) {
+    pthread_mutex_unlock(&pool.lock);
+    f(0, n, user_data);
+    return;
+  }
+
+  // Grow the pool:
+  while (pool.workers < threads - 1) {
+    if (pthread_create(pool.threads + pool.workers, 0, parallel_worker, 0) != 0)
+      break;
+    pool.workers++;
+  }
+  if (threads > pool.workers + 1)
+    threads = pool.workers + 1;
+
+  // Deal out the chunks:
+  pgfgd_ParallelJob job;
+  int i;
+  
+  job.fun = f;
+  job.user_data = user_data;
+  job.n = n;
+  job.grain = (n + threads * PARALLEL_CHUNKS_PER_THREAD - 1) / (threads * PARALLEL_CHUNKS_PER_THREAD);
+  job.participants = threads;
+  job.runs = (pgfgd_ParallelRun*) calloc(threads, sizeof(pgfgd_ParallelRun));
+  job.joined = 0;
+  job.left = 0;
+
+  int chunks = (n + job.grain - 1) / job.grain;
+  for (i = 0; i < threads; i++) {
+    pthread_mutex_init(&job.runs[i].lock, 0);
+    job.runs[i].next = (int) ((long) chunks * i / threads);
+    job.runs[i].end  = (int) ((long) chunks * (i+1) / threads);
+  }
+
+  pool.job = &job;
+  pool.generation++;
+  pthread_cond_broadcast(&pool.job_posted);
+  pthread_mutex_unlock(&pool.lock);
+
+  parallel_work(&job, 0);
+
+  // Once the calling thread is done, all chunks have been taken;
+  // wait for the workers that are still busy with theirs:
+  pthread_mutex_lock(&pool.lock);
+  while (job.left < job.joined)
+    pthread_cond_wait(&pool.worker_left, &pool.lock);
+  pool.job = 0;
+  pthread_mutex_unlock(&pool.lock);
+
+  for (i = 0; i < threads; i++)
+    pthread_mutex_destroy(&job.runs[i].lock);
+  free(job.runs);
+}
+
+#else
+
+static void register_pool_shutdown(lua_State* L)
+{
+  (void) L;
+}
+
+void pgfgd_parallel_for(pgfgd_SyntacticDigraph* g, int n, pgfgd_parallel_fun f, void* user_data)
+{
+  (void) g;
+  if (n > 0)
+    f(0, n, user_data);
+}
+
+#endif
+
+
 
 // Handling declarations
 
@@ -958,9 +2758,39 @@ struct pgfgd_Declaration {
 
   int                    post_length;
   const char**           post;
+
+  int                    snapshot_length;
+  const char**           snapshot;
+
+  int                    detached;
+  
+  int                    snapshot_digraphs_length;
+  const char**           snapshot_digraphs;
+
+  int                    snapshot_anchors_length;
+  const char**           snapshot_anchors;
 };
 
 
+static pgfgd_DetachedInputs* make_detached_inputs(pgfgd_Declaration* d)
+{
+  pgfgd_DetachedInputs* inputs = (pgfgd_DetachedInputs*) calloc(1, sizeof(pgfgd_DetachedInputs));
+  int i;
+  
+  inputs->digraphs_length = d->snapshot_digraphs_length;
+  inputs->digraphs = (pgfgd_key_ref*) calloc(d->snapshot_digraphs_length, sizeof(pgfgd_key_ref));
+  for (i = 0; i < d->snapshot_digraphs_length; i++)
+    inputs->digraphs[i] = pgfgd_intern(d->snapshot_digraphs[i]);
+  
+  inputs->anchors_length = d->snapshot_anchors_length;
+  inputs->anchors = (pgfgd_key_ref*) calloc(d->snapshot_anchors_length, sizeof(pgfgd_key_ref));
+  for (i = 0; i < d->snapshot_anchors_length; i++)
+    inputs->anchors[i] = pgfgd_intern(d->snapshot_anchors[i]);
+
+  return inputs;
+}
+
+
 pgfgd_Declaration* pgfgd_new_key (const char* key)
 {
   pgfgd_Declaration* d = (pgfgd_Declaration*) calloc(1, sizeof(pgfgd_Declaration));
@@ -976,6 +2806,8 @@ void pgfgd_declare(struct lua_State* state, pgfgd_Declaration* d)
     int tos = lua_gettop(state);
 
     lua_gc(state, LUA_GCSTOP, 0); // Remove once Lua Link Bug is fixed
+
+    register_pool_shutdown(state);
     
     // Find declare function:
     lua_getglobal(state, "require");
@@ -1058,9 +2890,37 @@ void pgfgd_declare(struct lua_State* state, pgfgd_Declaration* d)
       lua_getglobal(state, "require");
       lua_pushstring(state, "pgf.gd.model.Digraph");
       lua_call(state, 1, 1);
+
+      // The options to be snapshot (these live as long as the algorithm):
+      if (d->snapshot_length > 0)
+	lua_pushlightuserdata(state, (void *) make_option_keys(d->snapshot_length, d->snapshot));
+      else
+	lua_pushlightuserdata(state, 0);
+
+      // The Path and Coordinate classes, needed when the results are
+      // written back:
+      lua_getglobal(state, "require");
+      lua_pushstring(state, "pgf.gd.model.Path");
+      lua_call(state, 1, 1);
+      
+      lua_getglobal(state, "require");
+      lua_pushstring(state, "pgf.gd.model.Coordinate");
+      lua_call(state, 1, 1);
+      
+      // What a detached algorithm needs besides the snapshot (this
+      // also lives as long as the algorithm):
+      if (d->detached)
+	lua_pushlightuserdata(state, (void *) make_detached_inputs(d));
+      else
+	lua_pushlightuserdata(state, 0);
       
-      lua_pushcclosure(state, algorithm_dispatcher, 3);
+      lua_pushcclosure(state, algorithm_dispatcher, 7);
       lua_setfield(state, -2, "algorithm_written_in_c");
+
+      if (d->detached) {
+	lua_pushcfunction(state, run_detached);
+	lua_setfield(state, -2, "run_detached_in_c");
+      }
     }
 
     // Call the declare function:
@@ -1121,6 +2981,40 @@ void pgfgd_key_add_postcondition(pgfgd_Declaration* d, const char* s)
   d->post[d->post_length-1] = s;
 }
 
+void pgfgd_key_add_snapshot_option(pgfgd_Declaration* d, const char* s)
+{
+  d->snapshot_length++;
+  d->snapshot = (const char **) realloc(d->snapshot, d->snapshot_length*sizeof(const char*));
+  
+  d->snapshot[d->snapshot_length-1] = s;
+}
+
+void pgfgd_key_detached(pgfgd_Declaration* d)
+{
+  d->detached = 1;
+
+  // Needed for pgfgd_path_append_moveto_tail and
+  // pgfgd_path_append_lineto_head:
+  pgfgd_key_add_snapshot_option(d, "tail anchor");
+  pgfgd_key_add_snapshot_option(d, "head anchor");
+}
+
+void pgfgd_key_add_snapshot_digraph(pgfgd_Declaration* d, const char* s)
+{
+  d->snapshot_digraphs_length++;
+  d->snapshot_digraphs = (const char **) realloc(d->snapshot_digraphs, d->snapshot_digraphs_length*sizeof(const char*));
+  
+  d->snapshot_digraphs[d->snapshot_digraphs_length-1] = s;
+}
+
+void pgfgd_key_add_snapshot_anchor(pgfgd_Declaration* d, const char* s)
+{
+  d->snapshot_anchors_length++;
+  d->snapshot_anchors = (const char **) realloc(d->snapshot_anchors, d->snapshot_anchors_length*sizeof(const char*));
+  
+  d->snapshot_anchors[d->snapshot_anchors_length-1] = s;
+}
+
 void pgfgd_key_summary(pgfgd_Declaration* d, const char* s)
 {
   d->summary = s;
@@ -1184,6 +3078,9 @@ void pgfgd_free_key(pgfgd_Declaration* d)
     free(d->use_keys);
     free(d->use_values_user);
     free(d->use_values_strings);
+    free(d->snapshot);
+    free(d->snapshot_digraphs);
+    free(d->snapshot_anchors);
     free(d);    
   }
 }
@@ -7,6 +7,7 @@
     in C for graph drawing in Lua.
 */
 
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +24,15 @@ extern "C" {
     pgfgd_isset and so on. Note that pointers to such option tables
     will only be valid during a run of the algorithm; you cannot store
     a point to an option table past the run of an algorithm.
+
+    Normally, each query of an option table is a lookup in the Lua
+    table of the graph, vertex or edge. When an algorithm declares the
+    options it needs using pgfgd_key_add_snapshot_option, the values
+    of these options are copied into a C table for the graph and for
+    each vertex and edge before the algorithm is called. Queries for
+    these options are then answered without accessing Lua at all,
+    while queries for all other options still go to the Lua table
+    (unless the algorithm runs detached, see pgfgd_key_detached).
 */
     
 typedef struct pgfgd_OptionTable pgfgd_OptionTable;
@@ -63,6 +73,86 @@ int pgfgd_toboolean(pgfgd_OptionTable* t, const char* key);
     returns this user value. */
 void* pgfgd_touser(pgfgd_OptionTable* t, const char* key);
 
+/** Like pgfgd_tostring, but instead of a copy the function returns
+    the string stored in Lua (or, for numbers, a string
+    representation). You may not modify or free this string; it stays
+    valid until the graph drawing function returns. If length is not
+    null, the length of the string is stored in it. If
+    pgfgd_isstring would return 0 for the key, 0 is returned. */
+const char* pgfgd_tostring_view(pgfgd_OptionTable* t, const char* key, size_t* length);
+
+/** A handle for an interned option key. Passing a key as a string to
+    pgfgd_isset and the other functions above means that the string
+    must be hashed for each call. When you query the same key many
+    times (typically, for all vertices or edges of a graph), you
+    should intern the key once using pgfgd_intern and then use the
+    functions ending with _ref below, which take the handle instead of
+    the string.
+
+    Interning the same string twice yields the same handle. Unlike
+    option tables, handles stay valid as long as the library is
+    loaded, so you can store them in static variables.
+*/
+typedef struct pgfgd_Key pgfgd_Key;
+typedef pgfgd_Key* pgfgd_key_ref;
+
+/** Returns the handle for the given key. */
+pgfgd_key_ref pgfgd_intern(const char* key);
+
+/** Returns the name of an interned key. */
+const char* pgfgd_key_name(pgfgd_key_ref key);
+
+/** Like pgfgd_isset, but for an interned key. */
+int pgfgd_isset_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_isnumber, but for an interned key. */
+int pgfgd_isnumber_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_isstring, but for an interned key. */
+int pgfgd_isstring_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_isboolean, but for an interned key. */
+int pgfgd_isboolean_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_isuser, but for an interned key. */
+int pgfgd_isuser_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_tonumber, but for an interned key. */
+double pgfgd_tonumber_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_tostring, but for an interned key. You must free the
+    returned string yourself. */
+char* pgfgd_tostring_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_tostring_view, but for an interned key. */
+const char* pgfgd_tostring_view_ref(pgfgd_OptionTable* t, pgfgd_key_ref key, size_t* length);
+
+/** Like pgfgd_toboolean, but for an interned key. */
+int pgfgd_toboolean_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Like pgfgd_touser, but for an interned key. */
+void* pgfgd_touser_ref(pgfgd_OptionTable* t, pgfgd_key_ref key);
+
+/** Everything that the functions above can tell about an option. */
+typedef struct pgfgd_Option {
+  int         is_set;
+  int         is_number;
+  int         is_boolean;
+  int         is_string;
+  int         is_user;
+  double      number;
+  int         boolean;
+  const char* string; // As returned by pgfgd_tostring_view
+  size_t      string_length;
+  void*       user;
+} pgfgd_Option;
+
+/** Fills option with the results of all the pgfgd_isxxx_ref and
+    pgfgd_toxxx_ref functions for the key, but looks up the key only
+    once. This is useful when you cache options or do not know the
+    type of an option beforehand. */
+void pgfgd_option_ref(pgfgd_OptionTable* t, pgfgd_key_ref key, pgfgd_Option* option);
+
 
 
 // Graph model
@@ -95,12 +185,29 @@ typedef struct pgfgd_Edge_array {
 } pgfgd_Edge_array;
 
   
+/** The kinds of entries of a pgfgd_Path. A path entry is either a
+    coordinate or one of the path operations, which correspond to the
+    strings "moveto", "lineto", "curveto", and "closepath" used in a
+    Lua Path. */
+typedef enum pgfgd_PathOp {
+  PGFGD_COORDINATE = 0,
+  PGFGD_MOVETO,
+  PGFGD_LINETO,
+  PGFGD_CURVETO,
+  PGFGD_CLOSEPATH
+} pgfgd_PathOp;
+
+/** Returns the Lua name of a path operation (like "moveto") or null
+    for PGFGD_COORDINATE. */
+extern const char* pgfgd_path_op_name(pgfgd_PathOp op);
+
+
 /** This struct is used to model a Lua Path. In Lua, a path is an
     array where each entry is either a Coordinate object or a
     string. This is modeled on the C layer by having
-    two arrays and for each position, either the coordinates array or
-    the strings array is set (the strings
-    array is set at position i if, and only if, it is not null).  
+    two arrays: For each position, the ops array tells whether the
+    entry is a coordinate (stored in the coordinates array at the same
+    position) or a path operation.
 
     Graph drawing functions may wish to modify Edge paths, namely
     whenever they wish to setup a special routing for an edge. In this
@@ -108,34 +215,46 @@ typedef struct pgfgd_Edge_array {
     must use the functions pgfgd_path_xxx to modify the path
     field. When the graph drawing function is done, the values stored
     in the the path fields of the Edges of the syntactic digraph are
-    copied back to Lua.
+    copied back to Lua. Only the paths that you have modified are
+    copied back, all other edges keep the path they have on the Lua
+    layer.
 
     Note that numbering starts at 0. Also note that you have to set
     the path field for each syntactic edge individually.
 
     The |length| field will be |-1| for the ``default path'' of an
-    edge. The actual path (a straight line from the tail to the head
-    vertex) is generated only when the graph is written back, because
-    only then the coordinates of the nodes will be known. 
+    edge, meaning that the path has not been modified. When the graph
+    is written back, such an edge gets a straight line from the tail
+    to the head vertex. If the Lua path of the edge already is such a
+    line (which follows the final positions of the vertices), it is
+    simply kept. Note that a path that you have cleared using
+    pgfgd_path_clear has length 0, not -1, and is written back as an
+    empty path.
 */
 
 typedef struct pgfgd_Path {
 
   /** Both arrays of this struct will have this length, except when
-      this field is set to -1, indicating that a default path should
-      be generated when this path is written back to the graph. */
+      this field is set to -1, indicating that the path has not been
+      modified. Such a path is written back as a straight line from
+      the tail to the head, unless the Lua path of the edge already
+      is one. */
   int                length;
 
+  /** The number of entries for which the arrays have room. The
+      arrays grow geometrically as entries are appended. */
+  int                capacity;
+
   /** An array of coordinates. Not all entries of this array are
-      relevant, namely only those for which the strings array is null
-      at the some position.
+      relevant, namely only those for which the ops array is
+      PGFGD_COORDINATE at the same position.
   */
   pgfgd_Coordinate*  coordinates;
 
-  /** An array of strings. Whenever an entry in this array is not
-      null, the entry in the coordinates array at the same position is
-      ignored. */
-  char**             strings;
+  /** An array of pgfgd_PathOp values. Whenever an entry in this array
+      is not PGFGD_COORDINATE (that is, not 0), the entry in the
+      coordinates array at the same position is ignored. */
+  unsigned char*     ops;
   
 } pgfgd_Path;
 
@@ -146,26 +265,52 @@ typedef struct pgfgd_Path {
     should not create them yourself or modify them, except for the pos
     field, which you should modify (indeed, this is the whole purpose
     of your graph drawing algorithm).
+
+    The strings name, shape, and kind are borrowed from the Lua
+    layer: They stay valid until the graph drawing function returns
+    and you may not modify or free them. If a field is not set on
+    the Lua layer, the string will be empty.
+
+    Note that this changes the public interface: In earlier versions,
+    these fields (and the direction of a pgfgd_Edge) had the type
+    char* and pointed to copies owned by the digraph. Code that
+    stores them in a char* must now use const char* instead and copy
+    the string if it needs it after the graph drawing function has
+    returned.
 */
 
 typedef struct pgfgd_Vertex {
   
   /** The name field of the Lua Vertex class. */
-  char* name;
+  const char* name;
+
+  /** The length of name. */
+  size_t name_length;
 
-  /** The path field of the Lua Vertex class. */
+  /** The path field of the Lua Vertex class. Since most algorithms
+      never need it, the path is only converted when it is first
+      requested: Always use pgfgd_vertex_path to access it; this
+      field will be null before the first call. */
   pgfgd_Path* path;
 
   /** The shape field of the Lua Vertex class. */
-  char* shape;
+  const char* shape;
+
+  /** The length of shape. */
+  size_t shape_length;
 
   /** The kind field of the Lua Vertex class. */
-  char* kind;
+  const char* kind;
+
+  /** The length of kind. */
+  size_t kind_length;
   
   /** The pos field of the Lua Vertex class. Unlike the other fields
       of this struct, you can write pos.x and pos.y. When the graph
       drawing function returns, the values stored in these fields
-      will be written back to the Lua layer.
+      will be written back to the Lua layer (for the vertices whose
+      position has changed). Alternatively, you can write the
+      positions to the x and y arrays of the syntactic digraph.
   */
   pgfgd_Coordinate pos;
   
@@ -189,8 +334,10 @@ typedef struct pgfgd_Vertex {
       object, the incoming and outgoing arcs depend on the graph,
       while a pgfgd_Vertex always only stores the incoming and
       outgoing edges of the syntactic digraph. The order of the edges
-      in the incoming array will be the same as on the Lua layer, but
-      numbering starts with 0 (since these are C arrays).
+      in the incoming array will be the same as in the syntactic_edges
+      array of the syntactic digraph, but numbering starts with 0
+      (since these are C arrays). The arrays of all vertices share two
+      buffers, so you may not free or resize them.
   */
   pgfgd_Edge_array incoming;
 
@@ -220,8 +367,26 @@ typedef struct pgfgd_Vertex_array {
 /** This function allows you to query an anchor of a vertex (like a
     call to |Vertex:anchor|). The function returns
     |1| if there is such an anchor, otherwise |0| is returned and
-    both |x| and |y| will be set to 0. */
+    both |x| and |y| will be set to 0. Each anchor of a vertex is
+    computed only once per run of the algorithm. A detached algorithm
+    only finds the anchors declared by pgfgd_key_add_snapshot_anchor. */
 extern int pgfgd_vertex_anchor(pgfgd_Vertex* v, const char* anchor, double* x, double* y);
+
+/** Like pgfgd_vertex_anchor, but the anchor is given as an interned
+    key (see pgfgd_intern). */
+extern int pgfgd_vertex_anchor_ref(pgfgd_Vertex* v, pgfgd_key_ref anchor, double* x, double* y);
+
+/** Returns the path field of the vertex, converting it from Lua on
+    the first call. */
+extern pgfgd_Path* pgfgd_vertex_path(pgfgd_Vertex* v);
+
+/** Computes the bounding box of the path of the vertex (like a call
+    to |Vertex:boundingBox|). This does not need the path to be
+    converted by pgfgd_vertex_path, so you should use this function
+    when you only need the size of the vertex. The function returns
+    |1| if the path contains at least one coordinate, otherwise |0|
+    is returned and all four values are set to 0. */
+extern int pgfgd_vertex_bbox(pgfgd_Vertex* v, double* min_x, double* min_y, double* max_x, double* max_y);
   
   
 
@@ -235,8 +400,12 @@ struct pgfgd_Edge {
   /** The head field of the Lua Edge class. */
   pgfgd_Vertex* head;
 
-  /** The direction field of the Lua Edge class. */
-  char* direction;
+  /** The direction field of the Lua Edge class. Like the strings of
+      a pgfgd_Vertex, this string is borrowed from the Lua layer. */
+  const char* direction;
+
+  /** The length of direction. */
+  size_t direction_length;
   
   /** The path field of the Lua Edge class. You can read this field
       directly, but you can write it only through the function whose
@@ -244,7 +413,8 @@ struct pgfgd_Edge {
 
       For each pgfgd_Edge object, at the end of the graph drawing
       routinge, the value stored in this field will be written back to
-      the path field of the original syntactic edge.
+      the path field of the original syntactic edge (see pgfgd_Path for
+      the paths that have not been modified).
   */
   pgfgd_Path* path;
 
@@ -311,12 +481,57 @@ typedef struct pgfgd_SyntacticDigraph {
    */
   pgfgd_OptionTable* options;
 
+  /** The x-coordinates of the positions of the vertices, indexed by
+      their array_index. Together with y, this array offers the
+      positions of all vertices in contiguous memory, so that an
+      algorithm can work on them in place instead of gathering the
+      pos fields into arrays of its own and scattering them back.
+
+      Initially, x[i] and y[i] are the pos field of the vertex with
+      array_index i. You may write either to these arrays or to the
+      pos fields, but you should not mix both for the same vertex:
+      When the graph drawing function returns, the pos field of a
+      vertex is written back to the Lua layer if it has been changed,
+      otherwise x[i] and y[i] are written back.
+  */
+  double* x;
+
+  /** The y-coordinates of the positions of the vertices, see x. */
+  double* y;
+  
   pgfgd_SyntacticDigraph_internals* internals;
   
 } pgfgd_SyntacticDigraph;
 
 
 
+// Reading an option for all vertices or edges at once
+
+/** Reads the option key from the options table of each vertex of the
+    syntactic digraph and stores the values in out, which must have
+    room for g->vertices.length doubles. The value for the vertex
+    with array_index i is stored in out[i]. If the option is not a
+    number (in the sense of pgfgd_isnumber) for a vertex, fallback
+    is stored instead.
+
+    This is much faster than calling pgfgd_tonumber for each vertex,
+    since the key is looked up only once and all vertices are
+    visited in a single pass. */
+extern void pgfgd_vertices_tonumber_array (pgfgd_SyntacticDigraph* g, const char* key, double* out, double fallback);
+
+/** Like pgfgd_vertices_tonumber_array, but for an interned key. */
+extern void pgfgd_vertices_tonumber_array_ref (pgfgd_SyntacticDigraph* g, pgfgd_key_ref key, double* out, double fallback);
+
+/** Like pgfgd_vertices_tonumber_array, but reads the option from the
+    syntactic edges; out must have room for
+    g->syntactic_edges.length doubles. */
+extern void pgfgd_edges_tonumber_array (pgfgd_SyntacticDigraph* g, const char* key, double* out, double fallback);
+
+/** Like pgfgd_edges_tonumber_array, but for an interned key. */
+extern void pgfgd_edges_tonumber_array_ref (pgfgd_SyntacticDigraph* g, pgfgd_key_ref key, double* out, double fallback);
+
+
+
 
 // Modifying edge bend paths
 
@@ -331,15 +546,21 @@ extern void pgfgd_path_append_moveto (pgfgd_Edge* e, double x, double y);
 /** This function adds a moveto to the |tail anchor| of the tail of
     the edge. This call is useful for ``starting'' a path. This
     function is a ``service function,'' you can achieve the same
-    effect by directly reading the option table of the tail vertex
-    and then using the pgfgd_vertex_anchor method. */
+    effect by directly reading the |tail anchor| option of the edge
+    and then using the pgfgd_vertex_anchor method. Like on the Lua
+    layer, an empty anchor means the center of the vertex. The anchor
+    is added to the position of the vertex that has been computed so
+    far: its pos field if you have changed it, otherwise the entries
+    of the x and y arrays of the syntactic digraph. */
 extern void pgfgd_path_append_moveto_tail (pgfgd_Edge* e);
   
 /** This function adds a lineto at the end of a path. */
 extern void pgfgd_path_append_lineto (pgfgd_Edge* e, double x, double y);
   
 /** This function adds a linto to the |head anchor| of the head of
-    the edge. This call is useful for ``ending'' a path. */
+    the edge. This call is useful for ``ending'' a path. The anchor
+    is taken from the options of the edge as for
+    pgfgd_path_append_moveto_tail. */
 extern void pgfgd_path_append_lineto_head (pgfgd_Edge* e);
   
 /** This function adds a closepath at the end of a path. */
@@ -422,7 +643,8 @@ typedef struct pgfgd_Arc_array {
     function will then return a handle to this digraph which you can
     subsequently access. The handle will become invalid at the end of
     the graph drawing function and you must free it explicitly using
-    pgfgd_digraph_free. 
+    pgfgd_digraph_free. A detached algorithm gets 0 for digraphs that
+    it has not declared using pgfgd_key_add_snapshot_digraph.
  */
 extern pgfgd_Digraph*    pgfgd_get_digraph              (pgfgd_SyntacticDigraph* g, const char* graph_name);
 
@@ -457,7 +679,8 @@ extern pgfgd_Vertex*     pgfgd_digraph_syntactic_vertex (pgfgd_Digraph* g, int v
 
 /** Tests whether there is an arc between two vertices in the digraph
     g. The tail and head are indices starting with 1. This operation
-    takes time $O(1)$.
+    takes time $O(1)$; only the first call for a digraph handle needs
+    linear time to build a hash table of all arcs of the digraph.
 */
 extern int               pgfgd_digraph_isarc            (pgfgd_Digraph* g, int tail, int head);
 
@@ -489,6 +712,76 @@ extern pgfgd_Arc_array*  pgfgd_digraph_incoming         (pgfgd_Digraph* g, int v
 /** Like pgfgd_digraph_incoming. */
 extern pgfgd_Arc_array*  pgfgd_digraph_outgoing         (pgfgd_Digraph* g, int v);
 
+
+/** A read-only snapshot of the adjacency structure of a digraph in
+    compressed sparse row format. While pgfgd_digraph_incoming and
+    pgfgd_digraph_outgoing need to query the Lua layer for each
+    vertex, this structure is computed once and then allows you to
+    iterate over the neighbours of all vertices at native speed.
+
+    As for pgfgd_Arc_array, vertices are numbered starting with 1
+    (their positions in the Lua vertices array), while the arrays
+    themselves start with 0. For a vertex v, the heads of its
+    outgoing arcs are
+    out_heads[out_offsets[v-1]], ..., out_heads[out_offsets[v]-1]
+    in the order given by pgfgd_digraph_outgoing, and, likewise, the
+    tails of its incoming arcs are stored in in_tails between
+    in_offsets[v-1] and in_offsets[v].
+*/
+typedef struct pgfgd_Digraph_csr {
+
+  /** The number of vertices of the digraph. */
+  int num_vertices;
+
+  /** The number of arcs of the digraph. */
+  int num_arcs;
+
+  /** An array of num_vertices+1 offsets into out_heads. */
+  int* out_offsets;
+
+  /** An array of num_arcs heads. */
+  int* out_heads;
+
+  /** An array of num_vertices+1 offsets into in_tails. */
+  int* in_offsets;
+
+  /** An array of num_arcs tails. */
+  int* in_tails;
+  
+} pgfgd_Digraph_csr;
+
+/** Returns the adjacency structure of the digraph in compressed
+    sparse row format. It is computed on the first call and then
+    stored in the pgfgd_Digraph object, which also owns it: You may
+    not modify or free it; it is freed by pgfgd_digraph_free. */
+extern const pgfgd_Digraph_csr* pgfgd_digraph_csr       (pgfgd_Digraph* g);
+
+
+/** The syntactic edges of all arcs of a digraph at once. Arcs are
+    numbered as in the out_heads array of the digraph's
+    pgfgd_Digraph_csr: The syntactic edges of the arc stored at
+    out_heads[a] are given by arcs[a], which is a slice of the
+    syntactic_edges array of the syntactic digraph (and may be
+    empty). The slices are exactly what pgfgd_digraph_syntactic_edges
+    would return for the arc.
+*/
+typedef struct pgfgd_Digraph_syntactic_edges {
+
+  /** The number of arcs of the digraph. */
+  int num_arcs;
+
+  /** An array of num_arcs slices of edges. */
+  pgfgd_Edge_array* arcs;
+  
+} pgfgd_Digraph_syntactic_edges;
+
+/** Returns the syntactic edges of all arcs of the digraph, computed
+    in a single pass over the arcs. Use this instead of calling
+    pgfgd_digraph_syntactic_edges for every arc. Like the result of
+    pgfgd_digraph_csr, the returned object is stored in and owned by
+    the pgfgd_Digraph object and freed by pgfgd_digraph_free. */
+extern const pgfgd_Digraph_syntactic_edges* pgfgd_digraph_all_syntactic_edges (pgfgd_Digraph* g);
+
 /** Frees a pgfgd_Digraph object previously allocated by the
     pgfgd_get_digraph function. */
 extern void              pgfgd_digraph_free             (pgfgd_Digraph* d);
@@ -507,6 +800,59 @@ extern void              pgfgd_digraph_free_edge_array  (pgfgd_Edge_array* edges
 
 
 
+// Timing
+
+/** Returns the time in seconds of a monotonic, high-resolution
+    clock. Only differences of its values are meaningful. */
+extern double pgfgd_clock (void);
+
+/** Adds seconds to the time spent in the given phase of the current
+    run of an algorithm; the phase must be a string constant. The
+    interface itself records the phases |construct_digraph| (turning
+    the Lua graph into the C model, including the snapshots of a
+    detached algorithm), |algorithm| (the algorithm function) and
+    |sync_digraph| (writing the results back). The C++ interface
+    further records the |bridge|, |run| and |unbridge| phases of a
+    runner, which, for OGDF algorithms, build the OGDF graph, run the
+    OGDF module, and read back the result.
+
+    When the |gd timing| option of the graph is set, the phase times
+    are stored, together with the numbers of vertices, edges and
+    written back path points, in the |timing| field of the algorithm
+    object on the Lua side. This function does not access Lua, so it
+    may also be called by detached algorithms. */
+extern void pgfgd_add_phase_time (pgfgd_SyntacticDigraph* g, const char* phase, double seconds);
+
+
+
+// Running code in parallel
+
+/** The type of the functions passed to pgfgd_parallel_for. The
+    function should handle all indices i with from <= i < to. */
+typedef void (*pgfgd_parallel_fun) (int from, int to, void* user_data);
+
+/** Calls the function f for all indices from 0 to n-1 and returns
+    once all calls have returned. The range is split into chunks that
+    are handled concurrently by a pool of threads shared by all
+    algorithms of the library, so f may be called from several threads
+    at once, but never twice for the same index. The number of threads
+    is given by the |gd threads| option of the graph g (with 0, the
+    default, meaning one per processor); g may also be 0.
+
+    Since Lua is not thread safe, f must not call functions of this
+    interface that access Lua, like querying an option that is not
+    part of the snapshot. In a detached algorithm (see
+    pgfgd_key_detached) no function does. When pgfgd_parallel_for is
+    called while the pool is busy, for instance from inside f or from
+    a detached algorithm that is run on several components at once,
+    all indices are handled by the calling thread, so that the
+    processors are never oversubscribed. The same happens when the
+    library is compiled where POSIX threads are not available or
+    with PGFGD_NO_THREADS defined. */
+extern void pgfgd_parallel_for (pgfgd_SyntacticDigraph* g, int n, pgfgd_parallel_fun f, void* user_data);
+
+
+
 // Declarations
 
 struct lua_State;
@@ -596,6 +942,45 @@ extern void pgfgd_key_add_precondition  (pgfgd_Declaration* d, const char* s);
 /** Adds a postcondition to the key. */
 extern void pgfgd_key_add_postcondition (pgfgd_Declaration* d, const char* s);
 
+/** Adds an option to the list of options that the algorithm of the
+    key reads. Before the algorithm is called, the values of all
+    options added in this way are copied from the options tables of
+    the graph, of all vertices and of all edges into C tables, so that
+    the pgfgd_isset, pgfgd_tonumber and related functions need not
+    access Lua for them. You should add those options that your
+    algorithm reads for all vertices or edges.
+*/
+extern void pgfgd_key_add_snapshot_option (pgfgd_Declaration* d, const char* key);
+
+/** Declares that the algorithm of the key runs detached from Lua:
+    Everything the algorithm may query is extracted from Lua before
+    it is called and the results are written back only after it has
+    returned, so the algorithm itself never touches the Lua state.
+
+    While a detached algorithm runs, options that have not been added
+    using pgfgd_key_add_snapshot_option are not set, anchors that
+    have not been added using pgfgd_key_add_snapshot_anchor are not
+    found, and pgfgd_get_digraph returns 0 for all digraphs that have
+    not been added using pgfgd_key_add_snapshot_digraph. The paths of
+    all vertices and the anchors needed by
+    pgfgd_path_append_moveto_tail and pgfgd_path_append_lineto_head
+    are always extracted.
+
+    When the |parallel components| key is set, a detached algorithm
+    is run on all components of a graph at once using
+    pgfgd_parallel_for. The algorithm function may then be called
+    concurrently, so it must not modify global state.
+*/
+extern void pgfgd_key_detached (pgfgd_Declaration* d);
+
+/** Adds a digraph like "ugraph" that a detached algorithm
+    accesses through pgfgd_get_digraph. */
+extern void pgfgd_key_add_snapshot_digraph (pgfgd_Declaration* d, const char* graph_name);
+
+/** Adds an anchor that a detached algorithm queries for the vertices
+    using pgfgd_vertex_anchor. */
+extern void pgfgd_key_add_snapshot_anchor (pgfgd_Declaration* d, const char* anchor);
+
 /** After all properties of an option key have been set, call this
     function once to actually declare the key inside the state that
     your graph drawing library's main function gets 
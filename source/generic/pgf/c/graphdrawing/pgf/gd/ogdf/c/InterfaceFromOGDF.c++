@@ -9,54 +9,56 @@ using namespace ogdf;
 namespace scripting {
 
   
+  ogdf_runner::ogdf_runner ()
+    : graph_attributes (graph,
+			GraphAttributes::nodeGraphics |
+			GraphAttributes::edgeGraphics |
+			GraphAttributes::nodeLevel |
+			GraphAttributes::edgeIntWeight |
+			GraphAttributes::edgeDoubleWeight |
+			GraphAttributes::nodeWeight)
+  {
+  }
+  
+  bool ogdf_runner::uses_initial_positions () const
+  {
+    return false;
+  }
+  
   void ogdf_runner::bridge ()
   {
-    graph            = Graph();
-    graph_attributes = GraphAttributes (graph,
-					GraphAttributes::nodeGraphics |
-					GraphAttributes::edgeGraphics |
-					GraphAttributes::nodeLevel |
-					GraphAttributes::edgeIntWeight |
-					GraphAttributes::edgeDoubleWeight |
-					GraphAttributes::nodeWeight);
+    // Clearing the graph also resets all attribute arrays registered
+    // with it, so graph_attributes need not be initialized anew:
+    graph.clear();
     
     pgfgd_SyntacticDigraph* g = parameters->syntactic_digraph;
     
     int n = g->vertices.length;
     int m = g->syntactic_edges.length;
     
-    node* nodes = new node [n];
+    nodes.resize(n);
+
+    bool seed = uses_initial_positions();
     
     for (int i=0; i < n; i++) {
+      pgfgd_Vertex* v = g->vertices.array[i];
+      
       nodes[i] = graph.newNode();
 
       // Compute width and height
-      double x1, x2,y1,y2;
-      x1 = x2 = y1 = y2 = 0;
-      
-      int first = 1;
-
-      pgfgd_Path* path = g->vertices.array[i]->path;
-      
-      for (int j = 1; j < path->length; j++) 
-	if (!path->strings[j]) {
-	  double x = path->coordinates[j].x;
-	  double y = path->coordinates[j].y;
-	  
-	  if (first) {
-	    x1 = x2 = x;
-	    y1 = y2 = y;
-	    first = 0;
-	  } else {
-	    x1 = x < x1 ? x : x1;
-	    x2 = x > x2 ? x : x2;
-	    y1 = y < y1 ? y : y1;
-	    y2 = y > y2 ? y : y2;
-	  }
-	}
+      double x1, y1, x2, y2;
+      pgfgd_vertex_bbox(v, &x1, &y1, &x2, &y2);
       
       graph_attributes.width(nodes[i]) = x2-x1;
       graph_attributes.height(nodes[i]) = y2-y1;	
+
+      // Start from the current position, if the algorithm is
+      // configured to improve a given layout. Otherwise, all nodes
+      // start at the origin, as they always did:
+      if (seed) {
+	graph_attributes.x(nodes[i]) = v->pos.x;
+	graph_attributes.y(nodes[i]) = v->pos.y;
+      }
     }
     
     for (int i=0; i < m; i++) {
@@ -74,8 +76,8 @@ namespace scripting {
     node v;
     int i;
     for (i = 0, v = graph.firstNode(); v; v=v->succ(), i++) {
-      g->vertices.array[i]->pos.x = graph_attributes.x(v);
-      g->vertices.array[i]->pos.y = graph_attributes.y(v);
+      g->x[i] = graph_attributes.x(v);
+      g->y[i] = graph_attributes.y(v);
     }
     
     edge e;
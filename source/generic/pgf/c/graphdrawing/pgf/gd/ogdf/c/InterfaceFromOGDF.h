@@ -11,18 +11,33 @@
 #include <ogdf/basic/Graph.h>
 #include <ogdf/basic/GraphAttributes.h>
 
+#include <vector>
+
 namespace scripting {
   
   class ogdf_runner : public runner {
   public:
 
+    ogdf_runner ();
+    
     void bridge ();
     void unbridge ();
     
   protected:
 
+    // Whether the algorithm starts from the current positions of the
+    // vertices, which are then copied to graph_attributes. The
+    // default is false, so all nodes start at the origin.
+    virtual bool uses_initial_positions () const;
+    
+    // The graph and its attributes are kept from run to run, so that
+    // their storage is reused:
     ogdf::Graph           graph;
     ogdf::GraphAttributes graph_attributes;
+
+  private:
+
+    std::vector<ogdf::node> nodes;
     
   };
   
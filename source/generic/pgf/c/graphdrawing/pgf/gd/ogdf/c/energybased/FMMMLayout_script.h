@@ -12,14 +12,40 @@ struct FMMMLayout_script :
     layout.newInitialPlacement(false);
     layout.qualityVersusSpeed(FMMMLayout::qvsGorgeousAndEfficient);
     
-    parameters->configure_option ("FMMMLayout.unitEdgeLength",
-				  &FMMMLayout::unitEdgeLength, layout);
-    parameters->configure_option ("FMMMLayout.randSeed",
-				  &FMMMLayout::randSeed, layout);
+    parameters->configure_options<FMMMLayout_script> (layout);
+
+    if (uses_initial_positions())
+      layout.initialPlacementForces(FMMMLayout::ipfKeepPositions);
 	  
     layout.call (graph_attributes);
   }
   
+  // With keepPositions, the initial placement starts from the
+  // current positions instead of random ones. The bridge asks for
+  // this before the layout object exists, in order to copy the
+  // positions into graph_attributes, so the option is read here and
+  // not through the setters of options below:
+  bool uses_initial_positions () const {
+    bool keep = false;
+    parameters->option ("FMMMLayout.keepPositions", keep);
+    return keep;
+  }
+  
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("FMMMLayout.unitEdgeLength", &FMMMLayout::unitEdgeLength)
+       .type ("length")
+       .initial ("1cm")
+       .alias_function ("function (o) return o['node pre sep'] + o['node post sep'] end"));
+    v (describe ("FMMMLayout.randSeed", &FMMMLayout::randSeed)
+       .type ("number")
+       .initial ("42")
+       .alias ("random seed"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -28,16 +54,13 @@ struct FMMMLayout_script :
 	       .algorithm (this)
 	       .documentation_in ("pgf.gd.doc.ogdf.energybased.FMMMLayout"));
 
-    s.declare (key ("FMMMLayout.randSeed")
-	       .type ("number")
-	       .initial ("42")
-	       .alias ("random seed")
-	       .documentation_in ("pgf.gd.doc.ogdf.energybased.FMMMLayout"));
-    
-    s.declare (key ("FMMMLayout.unitEdgeLength")
-	       .type ("length") 
-	       .initial ("1cm")
-	       .alias_function ("function (o) return o['node pre sep'] + o['node post sep'] end")
+    declare_options<FMMMLayout_script> (s, "pgf.gd.doc.ogdf.energybased.FMMMLayout");
+
+    // Not an option descriptor: FMMMLayout has no setter taking the
+    // flag, it is turned into initialPlacementForces in run.
+    s.declare (key ("FMMMLayout.keepPositions")
+	       .type ("boolean")
+	       .initial ("false")
 	       .documentation_in ("pgf.gd.doc.ogdf.energybased.FMMMLayout"));
   }
   
@@ -9,18 +9,27 @@ struct FastMultipoleEmbedder_script :
     using namespace ogdf;
     FastMultipoleEmbedder* r = new FastMultipoleEmbedder;
 
-    parameters->configure_option ("FastMultipoleEmbedder.numIterations",
-                                  &FastMultipoleEmbedder::setNumIterations, *r);
-    parameters->configure_option ("FastMultipoleEmbedder.multipolePrec",
-                                  &FastMultipoleEmbedder::setMultipolePrec, *r);
-    parameters->configure_option ("FastMultipoleEmbedder.defaultEdgeLength",
-                                  &FastMultipoleEmbedder::setDefaultEdgeLength, *r);
-    parameters->configure_option ("FastMultipoleEmbedder.defaultNodeSize",
-                                  &FastMultipoleEmbedder::setDefaultNodeSize, *r);
+    parameters->configure_options<FastMultipoleEmbedder_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("FastMultipoleEmbedder.numIterations", &FastMultipoleEmbedder::setNumIterations)
+       .type ("number"));
+    v (describe ("FastMultipoleEmbedder.multipolePrec", &FastMultipoleEmbedder::setMultipolePrec)
+       .type ("number"));
+    v (describe ("FastMultipoleEmbedder.defaultEdgeLength", &FastMultipoleEmbedder::setDefaultEdgeLength)
+       .type ("length")
+       .alias_function ("function (o) return o['node pre sep'] + o['node post sep'] end"));
+    v (describe ("FastMultipoleEmbedder.defaultNodeSize", &FastMultipoleEmbedder::setDefaultNodeSize)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -29,23 +38,7 @@ struct FastMultipoleEmbedder_script :
                .set_module ("LayoutModule", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder"));
 
-    s.declare (key ("FastMultipoleEmbedder.numIterations")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder"));
-                    
-    s.declare (key ("FastMultipoleEmbedder.multipolePrec")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder"));
-                    
-    s.declare (key ("FastMultipoleEmbedder.defaultEdgeLength")
-               .type ("length")
-               .alias_function ("function (o) return o['node pre sep'] + o['node post sep'] end")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder"));
-                    
-    s.declare (key ("FastMultipoleEmbedder.defaultNodeSize")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder"));
-                    
+    declare_options<FastMultipoleEmbedder_script> (s, "pgf.gd.doc.ogdf.energybased.FastMultipoleEmbedder");
   }
   
 };
@@ -9,14 +9,7 @@ struct SpringEmbedderFRExact_script :
     using namespace ogdf;
     SpringEmbedderFRExact layout;
 
-    parameters->configure_option ("SpringEmbedderFRExact.iterations",
-                                  &SpringEmbedderFRExact::iterations, layout);
-    parameters->configure_option ("SpringEmbedderFRExact.noise",
-                                  &SpringEmbedderFRExact::noise, layout);
-    parameters->configure_option ("SpringEmbedderFRExact.idealEdgeLength",
-                                  &SpringEmbedderFRExact::idealEdgeLength, layout);
-    parameters->configure_option ("SpringEmbedderFRExact.convTolerance",
-                                  &SpringEmbedderFRExact::convTolerance, layout);
+    parameters->configure_options<SpringEmbedderFRExact_script> (layout);
 
     char* s = 0;
     
@@ -32,6 +25,21 @@ struct SpringEmbedderFRExact_script :
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("SpringEmbedderFRExact.iterations", &SpringEmbedderFRExact::iterations)
+       .type ("number"));
+    v (describe ("SpringEmbedderFRExact.noise", &SpringEmbedderFRExact::noise)
+       .type ("boolean"));
+    v (describe ("SpringEmbedderFRExact.idealEdgeLength", &SpringEmbedderFRExact::idealEdgeLength)
+       .type ("number"));
+    v (describe ("SpringEmbedderFRExact.convTolerance", &SpringEmbedderFRExact::convTolerance)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -41,26 +49,12 @@ struct SpringEmbedderFRExact_script :
                .algorithm (this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
 
-    s.declare (key ("SpringEmbedderFRExact.iterations")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
-                    
-    s.declare (key ("SpringEmbedderFRExact.noise")
-               .type ("boolean")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
-                    
+    declare_options<SpringEmbedderFRExact_script> (s, "pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact");
+
     s.declare (key ("SpringEmbedderFRExact.coolingFunction")
                .type ("string")
                .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
                     
-    s.declare (key ("SpringEmbedderFRExact.idealEdgeLength")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
-                    
-    s.declare (key ("SpringEmbedderFRExact.convTolerance")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFRExact"));
-                    
   }
   
 };
@@ -9,16 +9,24 @@ struct SpringEmbedderFR_script :
     using namespace ogdf;
     SpringEmbedderFR layout;
 
-    parameters->configure_option ("SpringEmbedderFR.iterations",
-                                  &SpringEmbedderFR::iterations, layout);
-    parameters->configure_option ("SpringEmbedderFR.noise",
-                                  &SpringEmbedderFR::noise, layout);
-    parameters->configure_option ("SpringEmbedderFR.scaleFunctionFactor",
-                                  &SpringEmbedderFR::scaleFunctionFactor, layout);
+    parameters->configure_options<SpringEmbedderFR_script> (layout);
           
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("SpringEmbedderFR.iterations", &SpringEmbedderFR::iterations)
+       .type ("number"));
+    v (describe ("SpringEmbedderFR.noise", &SpringEmbedderFR::noise)
+       .type ("boolean"));
+    v (describe ("SpringEmbedderFR.scaleFunctionFactor", &SpringEmbedderFR::scaleFunctionFactor)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -28,18 +36,7 @@ struct SpringEmbedderFR_script :
                .algorithm (this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFR"));
 
-    s.declare (key ("SpringEmbedderFR.iterations")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFR"));
-                    
-    s.declare (key ("SpringEmbedderFR.noise")
-               .type ("boolean")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFR"));
-                    
-    s.declare (key ("SpringEmbedderFR.scaleFunctionFactor")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderFR"));
-                    
+    declare_options<SpringEmbedderFR_script> (s, "pgf.gd.doc.ogdf.energybased.SpringEmbedderFR");
   }
   
 };
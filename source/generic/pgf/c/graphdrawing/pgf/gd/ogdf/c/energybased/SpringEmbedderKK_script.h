@@ -9,14 +9,22 @@ struct SpringEmbedderKK_script :
     using namespace ogdf;
     SpringEmbedderKK layout;
 
-    parameters->configure_option ("SpringEmbedderKK.stopTolerance",
-                                  &SpringEmbedderKK::setStopTolerance, layout);
-    parameters->configure_option ("SpringEmbedderKK.desLength",
-                                  &SpringEmbedderKK::setDesLength, layout);
+    parameters->configure_options<SpringEmbedderKK_script> (layout);
           
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("SpringEmbedderKK.stopTolerance", &SpringEmbedderKK::setStopTolerance)
+       .type ("number"));
+    v (describe ("SpringEmbedderKK.desLength", &SpringEmbedderKK::setDesLength)
+       .type ("length"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -26,14 +34,7 @@ struct SpringEmbedderKK_script :
                .algorithm (this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderKK"));
 
-    s.declare (key ("SpringEmbedderKK.stopTolerance")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderKK"));
-                    
-    s.declare (key ("SpringEmbedderKK.desLength")
-               .type ("length")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.SpringEmbedderKK"));
-                    
+    declare_options<SpringEmbedderKK_script> (s, "pgf.gd.doc.ogdf.energybased.SpringEmbedderKK");
   }
   
 };
@@ -9,12 +9,20 @@ struct BarycenterPlacer_script :
     using namespace ogdf;
     BarycenterPlacer* r = new BarycenterPlacer;
 
-    parameters->configure_option ("BarycenterPlacer.weightedPositionPriority",
-                                  &BarycenterPlacer::weightedPositionPriority, *r);
+    parameters->configure_options<BarycenterPlacer_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("BarycenterPlacer.weightedPositionPriority", &BarycenterPlacer::weightedPositionPriority)
+       .type ("boolean"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct BarycenterPlacer_script :
                .set_module ("InitialPlacer", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.BarycenterPlacer"));
 
-    s.declare (key ("BarycenterPlacer.weightedPositionPriority")
-               .type ("boolean")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.BarycenterPlacer"));
-                    
+    declare_options<BarycenterPlacer_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.BarycenterPlacer");
   }
   
 };
@@ -9,10 +9,7 @@ struct CirclePlacer_script :
     using namespace ogdf;
     CirclePlacer* r = new CirclePlacer;
 
-    parameters->configure_option ("CirclePlacer.circleSize",
-                                  &CirclePlacer::setCircleSize, *r);
-    parameters->configure_option ("CirclePlacer.radiusFixed",
-                                  &CirclePlacer::setRadiusFixed, *r);
+    parameters->configure_options<CirclePlacer_script> (*r);
 
 
     char* s = 0;
@@ -31,6 +28,17 @@ struct CirclePlacer_script :
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("CirclePlacer.circleSize", &CirclePlacer::setCircleSize)
+       .type ("number"));
+    v (describe ("CirclePlacer.radiusFixed", &CirclePlacer::setRadiusFixed)
+       .type ("boolean"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -39,14 +47,8 @@ struct CirclePlacer_script :
                .set_module ("InitialPlacer", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.CirclePlacer"));
 
-    s.declare (key ("CirclePlacer.circleSize")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.CirclePlacer"));
-                    
-    s.declare (key ("CirclePlacer.radiusFixed")
-               .type ("boolean")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.CirclePlacer"));
-                    
+    declare_options<CirclePlacer_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.CirclePlacer");
+
     s.declare (key ("CirclePlacer.nodeSelection")
                .type ("string")
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.CirclePlacer"));
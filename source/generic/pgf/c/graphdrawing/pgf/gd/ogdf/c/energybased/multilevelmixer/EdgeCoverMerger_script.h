@@ -9,12 +9,20 @@ struct EdgeCoverMerger_script :
     using namespace ogdf;
     EdgeCoverMerger* r = new EdgeCoverMerger;
 
-    parameters->configure_option ("EdgeCoverMerger.factor",
-                                  &EdgeCoverMerger::setFactor, *r);
+    parameters->configure_options<EdgeCoverMerger_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("EdgeCoverMerger.factor", &EdgeCoverMerger::setFactor)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct EdgeCoverMerger_script :
                .set_module ("MultilevelBuilder", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.EdgeCoverMerger"));
 
-    s.declare (key ("EdgeCoverMerger.factor")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.EdgeCoverMerger"));
-                    
+    declare_options<EdgeCoverMerger_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.EdgeCoverMerger");
   }
   
 };
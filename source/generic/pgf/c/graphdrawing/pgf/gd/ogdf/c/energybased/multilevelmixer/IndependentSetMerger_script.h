@@ -9,12 +9,20 @@ struct IndependentSetMerger_script :
     using namespace ogdf;
     IndependentSetMerger* r = new IndependentSetMerger;
 
-    parameters->configure_option ("IndependentSetMerger.searchDepthBase",
-                                  &IndependentSetMerger::setSearchDepthBase, *r);
+    parameters->configure_options<IndependentSetMerger_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("IndependentSetMerger.searchDepthBase", &IndependentSetMerger::setSearchDepthBase)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct IndependentSetMerger_script :
                .set_module ("MultilevelBuilder", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.IndependentSetMerger"));
 
-    s.declare (key ("IndependentSetMerger.searchDepthBase")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.IndependentSetMerger"));
-                    
+    declare_options<IndependentSetMerger_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.IndependentSetMerger");
   }
   
 };
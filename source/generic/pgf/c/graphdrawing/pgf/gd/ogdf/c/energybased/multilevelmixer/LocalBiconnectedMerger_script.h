@@ -9,12 +9,20 @@ struct LocalBiconnectedMerger_script :
     using namespace ogdf;
     LocalBiconnectedMerger* r = new LocalBiconnectedMerger;
 
-    parameters->configure_option ("LocalBiconnectedMerger.factor",
-                                  &LocalBiconnectedMerger::setFactor, *r);
+    parameters->configure_options<LocalBiconnectedMerger_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("LocalBiconnectedMerger.factor", &LocalBiconnectedMerger::setFactor)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct LocalBiconnectedMerger_script :
                .set_module ("MultilevelBuilder", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.LocalBiconnectedMerger"));
 
-    s.declare (key ("LocalBiconnectedMerger.factor")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.LocalBiconnectedMerger"));
-                    
+    declare_options<LocalBiconnectedMerger_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.LocalBiconnectedMerger");
   }
   
 };
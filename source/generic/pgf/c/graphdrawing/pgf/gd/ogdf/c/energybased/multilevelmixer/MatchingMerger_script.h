@@ -9,12 +9,20 @@ struct MatchingMerger_script :
     using namespace ogdf;
     MatchingMerger* r = new MatchingMerger;
 
-    parameters->configure_option ("MatchingMerger.selectByNodeMass",
-                                  &MatchingMerger::selectByNodeMass, *r);
+    parameters->configure_options<MatchingMerger_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("MatchingMerger.selectByNodeMass", &MatchingMerger::selectByNodeMass)
+       .type ("boolean"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct MatchingMerger_script :
                .set_module ("MultilevelBuilder", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.MatchingMerger"));
 
-    s.declare (key ("MatchingMerger.selectByNodeMass")
-               .type ("boolean")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.MatchingMerger"));
-                    
+    declare_options<MatchingMerger_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.MatchingMerger");
   }
   
 };
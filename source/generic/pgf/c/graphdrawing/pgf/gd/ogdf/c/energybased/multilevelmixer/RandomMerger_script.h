@@ -9,12 +9,20 @@ struct RandomMerger_script :
     using namespace ogdf;
     RandomMerger* r = new RandomMerger;
 
-    parameters->configure_option ("RandomMerger.factor",
-                                  &RandomMerger::setFactor, *r);
+    parameters->configure_options<RandomMerger_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("RandomMerger.factor", &RandomMerger::setFactor)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct RandomMerger_script :
                .set_module ("MultilevelBuilder", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomMerger"));
 
-    s.declare (key ("RandomMerger.factor")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomMerger"));
-                    
+    declare_options<RandomMerger_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomMerger");
   }
   
 };
@@ -9,12 +9,20 @@ struct RandomPlacer_script :
     using namespace ogdf;
     RandomPlacer* r = new RandomPlacer;
 
-    parameters->configure_option ("RandomPlacer.circleSize",
-                                  &RandomPlacer::setCircleSize, *r);
+    parameters->configure_options<RandomPlacer_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("RandomPlacer.circleSize", &RandomPlacer::setCircleSize)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct RandomPlacer_script :
                .set_module ("InitialPlacer", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomPlacer"));
 
-    s.declare (key ("RandomPlacer.circleSize")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomPlacer"));
-                    
+    declare_options<RandomPlacer_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.RandomPlacer");
   }
   
 };
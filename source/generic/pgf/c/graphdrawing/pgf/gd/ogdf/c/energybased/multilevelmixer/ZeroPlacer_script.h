@@ -9,12 +9,20 @@ struct ZeroPlacer_script :
     using namespace ogdf;
     ZeroPlacer* r = new ZeroPlacer;
 
-    parameters->configure_option ("ZeroPlacer.randomRange",
-                                  &ZeroPlacer::setRandomRange, *r);
+    parameters->configure_options<ZeroPlacer_script> (*r);
           
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("ZeroPlacer.randomRange", &ZeroPlacer::setRandomRange)
+       .type ("number"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -23,10 +31,7 @@ struct ZeroPlacer_script :
                .set_module ("InitialPlacer", this)
                .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.ZeroPlacer"));
 
-    s.declare (key ("ZeroPlacer.randomRange")
-               .type ("number")
-               .documentation_in ("pgf.gd.doc.ogdf.energybased.multilevelmixer.ZeroPlacer"));
-                    
+    declare_options<ZeroPlacer_script> (s, "pgf.gd.doc.ogdf.energybased.multilevelmixer.ZeroPlacer");
   }
   
 };
@@ -10,14 +10,23 @@ struct CoffmanGrahamRanking_script :
     using namespace ogdf;
     CoffmanGrahamRanking* r = new CoffmanGrahamRanking;
     
-    parameters->configure_option ("CoffmanGrahamRanking.width",
-				  &CoffmanGrahamRanking::width, *r);
+    parameters->configure_options<CoffmanGrahamRanking_script> (*r);
     parameters->configure_module ("AcyclicSubgraphModule",
 				  &CoffmanGrahamRanking::setSubgraph, *r);
     
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("CoffmanGrahamRanking.width", &CoffmanGrahamRanking::width)
+       .type ("number")
+       .initial ("3"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -25,10 +34,7 @@ struct CoffmanGrahamRanking_script :
 	       .documentation_in ("pgf.gd.doc.ogdf.layered.CoffmanGrahamRanking")
 	       .set_module ("RankingModule", this));
 
-    s.declare (key ("CoffmanGrahamRanking.width")
-	       .type ("number")
-	       .initial ("3")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.CoffmanGrahamRanking"));
+    declare_options<CoffmanGrahamRanking_script> (s, "pgf.gd.doc.ogdf.layered.CoffmanGrahamRanking");
   }
 };
 
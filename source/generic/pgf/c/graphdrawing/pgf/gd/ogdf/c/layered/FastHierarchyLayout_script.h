@@ -10,16 +10,27 @@ struct FastHierarchyLayout_script :
     using namespace ogdf;
     FastHierarchyLayout* r = new FastHierarchyLayout;
     
-    parameters->configure_option ("FastHierarchyLayout.fixedLayerDistance",
-				  &FastHierarchyLayout::fixedLayerDistance, *r);
-    parameters->configure_option ("FastHierarchyLayout.layerDistance",
-				  &FastHierarchyLayout::layerDistance, *r);
-    parameters->configure_option ("FastHierarchyLayout.nodeDistance",
-				  &FastHierarchyLayout::nodeDistance, *r);
+    parameters->configure_options<FastHierarchyLayout_script> (*r);
     
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("FastHierarchyLayout.fixedLayerDistance", &FastHierarchyLayout::fixedLayerDistance)
+       .type ("boolean")
+       .initial ("false"));
+    v (describe ("FastHierarchyLayout.layerDistance", &FastHierarchyLayout::layerDistance)
+       .type ("length")
+       .alias_function ("function (o) return o['level pre sep'] + o['level post sep'] end"));
+    v (describe ("FastHierarchyLayout.nodeDistance", &FastHierarchyLayout::nodeDistance)
+       .type ("length")
+       .alias_function ("function (o) return o['sibling pre sep'] + o['sibling post sep'] end"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -28,20 +39,7 @@ struct FastHierarchyLayout_script :
 	       .documentation_in ("pgf.gd.doc.ogdf.layered.FastHierarchyLayout")
 	       .set_module ("HierarchyLayoutModule", this));
 
-    s.declare (key ("FastHierarchyLayout.fixedLayerDistance")
-	       .type ("boolean")
-	       .initial ("false")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.FastHierarchyLayout"));
-
-    s.declare (key ("FastHierarchyLayout.layerDistance")
-	       .type ("length")
-	       .alias_function ("function (o) return o['level pre sep'] + o['level post sep'] end")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.FastHierarchyLayout"));
-
-    s.declare (key ("FastHierarchyLayout.nodeDistance")
-	       .type ("length")
-	       .alias_function ("function (o) return o['sibling pre sep'] + o['sibling post sep'] end")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.FastHierarchyLayout"));
+    declare_options<FastHierarchyLayout_script> (s, "pgf.gd.doc.ogdf.layered.FastHierarchyLayout");
   }
 };
 
@@ -10,12 +10,7 @@ struct LongestPathRanking_script :
     using namespace ogdf;
     LongestPathRanking* r = new LongestPathRanking;
 
-    parameters->configure_option ("LongestPathRanking.separateDeg0Layer",
-				  &LongestPathRanking::separateDeg0Layer, *r);
-    parameters->configure_option ("LongestPathRanking.separateMultiEdges",
-				  &LongestPathRanking::separateMultiEdges, *r);
-    parameters->configure_option ("LongestPathRanking.optimizeEdgeLength",
-				  &LongestPathRanking::optimizeEdgeLength, *r);
+    parameters->configure_options<LongestPathRanking_script> (*r);
 
     parameters->configure_module ("AcyclicSubgraphModule",
 				  &LongestPathRanking::setSubgraph, *r);
@@ -23,6 +18,22 @@ struct LongestPathRanking_script :
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("LongestPathRanking.separateDeg0Layer", &LongestPathRanking::separateDeg0Layer)
+       .type ("boolean")
+       .initial ("true"));
+    v (describe ("LongestPathRanking.separateMultiEdges", &LongestPathRanking::separateMultiEdges)
+       .type ("boolean")
+       .initial ("true"));
+    v (describe ("LongestPathRanking.optimizeEdgeLength", &LongestPathRanking::optimizeEdgeLength)
+       .type ("boolean")
+       .initial ("true"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -30,20 +41,7 @@ struct LongestPathRanking_script :
 	       .documentation_in ("pgf.gd.doc.ogdf.layered.LongestPathRanking")
 	       .set_module ("RankingModule", this));
 
-    s.declare (key ("LongestPathRanking.separateDeg0Layer")
-	       .type ("boolean")
-	       .initial ("true")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.LongestPathRanking"));
-
-    s.declare (key ("LongestPathRanking.separateMultiEdges")
-	       .type ("boolean")
-	       .initial ("true")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.LongestPathRanking"));
-
-    s.declare (key ("LongestPathRanking.optimizeEdgeLength")
-	       .type ("boolean")
-	       .initial ("true")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.LongestPathRanking"));
+    declare_options<LongestPathRanking_script> (s, "pgf.gd.doc.ogdf.layered.LongestPathRanking");
   }
 };
 
@@ -10,14 +10,23 @@ struct OptimalRanking_script :
     using namespace ogdf;
     OptimalRanking* r = new OptimalRanking;
     
-    parameters->configure_option ("OptimalRanking.separateMultiEdges",
-				  &OptimalRanking::separateMultiEdges, *r);
+    parameters->configure_options<OptimalRanking_script> (*r);
     parameters->configure_module ("AcyclicSubgraphModule",
 				  &OptimalRanking::setSubgraph, *r);
     
     return r;
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("OptimalRanking.separateMultiEdges", &OptimalRanking::separateMultiEdges)
+       .type ("boolean")
+       .initial ("true"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -25,10 +34,7 @@ struct OptimalRanking_script :
 	       .documentation_in ("pgf.gd.doc.ogdf.layered.OptimalRanking")
 	       .set_module ("RankingModule", this));
 
-    s.declare (key ("OptimalRanking.separateMultiEdges")
-	       .type ("boolean")
-	       .initial ("true")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.OptimalRanking"));
+    declare_options<OptimalRanking_script> (s, "pgf.gd.doc.ogdf.layered.OptimalRanking");
   }
 };
 
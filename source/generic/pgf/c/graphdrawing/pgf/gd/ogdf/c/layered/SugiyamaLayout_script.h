@@ -9,12 +9,7 @@ struct SugiyamaLayout_script :
     using namespace ogdf;
     SugiyamaLayout layout;
     
-    parameters->configure_option ("SugiyamaLayout.runs",
-				  &SugiyamaLayout::runs, layout);
-    parameters->configure_option ("SugiyamaLayout.transpose",
-				  &SugiyamaLayout::transpose, layout);
-    parameters->configure_option ("SugiyamaLayout.fails",
-				  &SugiyamaLayout::fails, layout);
+    parameters->configure_options<SugiyamaLayout_script> (layout);
     
     parameters->configure_module ("RankingModule",
 				  &SugiyamaLayout::setRanking, layout);
@@ -26,6 +21,22 @@ struct SugiyamaLayout_script :
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("SugiyamaLayout.runs", &SugiyamaLayout::runs)
+       .type ("number")
+       .initial ("15"));
+    v (describe ("SugiyamaLayout.transpose", &SugiyamaLayout::transpose)
+       .type ("boolean")
+       .initial ("true"));
+    v (describe ("SugiyamaLayout.fails", &SugiyamaLayout::fails)
+       .type ("number")
+       .initial ("4"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -35,20 +46,7 @@ struct SugiyamaLayout_script :
 	       .algorithm (this)
 	       .documentation_in ("pgf.gd.doc.ogdf.layered.SugiyamaLayout"));
 
-    s.declare (key ("SugiyamaLayout.runs")
-	       .type ("number")
-	       .initial ("15")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.SugiyamaLayout"));
-    
-    s.declare (key ("SugiyamaLayout.transpose")
-	       .type ("boolean") 
-	       .initial ("true") 
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.SugiyamaLayout"));
-    
-    s.declare (key ("SugiyamaLayout.fails")
-	       .type ("number") 
-	       .initial ("4") 
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.SugiyamaLayout"));
+    declare_options<SugiyamaLayout_script> (s, "pgf.gd.doc.ogdf.layered.SugiyamaLayout");
   }
   
 };
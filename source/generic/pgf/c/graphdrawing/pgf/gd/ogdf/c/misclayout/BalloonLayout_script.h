@@ -9,12 +9,20 @@ struct BalloonLayout_script :
     using namespace ogdf;
     BalloonLayout layout;
     
-    parameters->configure_option ("BalloonLayout.evenAngles",
-				  &BalloonLayout::setEvenAngles, layout);
+    parameters->configure_options<BalloonLayout_script> (layout);
     
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("BalloonLayout.evenAngles", &BalloonLayout::setEvenAngles)
+       .type ("boolean"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -24,9 +32,7 @@ struct BalloonLayout_script :
 	       .algorithm (this)
 	       .documentation_in ("pgf.gd.doc.ogdf.misclayout.BalloonLayout"));
 
-    s.declare (key ("BalloonLayout.evenAngles")
-	       .type ("boolean")
-	       .documentation_in ("pgf.gd.doc.ogdf.misclayout.BalloonLayout"));
+    declare_options<BalloonLayout_script> (s, "pgf.gd.doc.ogdf.misclayout.BalloonLayout");
   }
 };
 
@@ -9,16 +9,27 @@ struct CircularLayout_script :
     using namespace ogdf;
     CircularLayout layout;
     
-    parameters->configure_option ("CircularLayout.minDistCircle",
-				  &CircularLayout::minDistCircle, layout);
-    parameters->configure_option ("CircularLayout.minDistLevel",
-				  &CircularLayout::minDistLevel, layout);
-    parameters->configure_option ("CircularLayout.minDistSibling",
-				  &CircularLayout::minDistSibling, layout);
+    parameters->configure_options<CircularLayout_script> (layout);
     
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("CircularLayout.minDistCircle", &CircularLayout::minDistCircle)
+       .type ("length")
+       .alias_function ("function (o) return o['part pre sep'] + o['part post sep'] end"));
+    v (describe ("CircularLayout.minDistLevel", &CircularLayout::minDistLevel)
+       .type ("length")
+       .alias_function ("function (o) return o['level pre sep'] + o['level post sep'] end"));
+    v (describe ("CircularLayout.minDistSibling", &CircularLayout::minDistSibling)
+       .type ("length")
+       .alias_function ("function (o) return o['sibling pre sep'] + o['sibling post sep'] end"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -28,20 +39,7 @@ struct CircularLayout_script :
 	       .algorithm (this)
 	       .documentation_in ("pgf.gd.doc.ogdf.misclayout.CircularLayout"));
     
-    s.declare (key ("CircularLayout.minDistCircle")
-	       .type ("length")
-	       .alias_function ("function (o) return o['part pre sep'] + o['part post sep'] end")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.CircularLayout"));
-
-    s.declare (key ("CircularLayout.minDistLevel")
-	       .type ("length")
-	       .alias_function ("function (o) return o['level pre sep'] + o['level post sep'] end")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.CircularLayout"));
-
-    s.declare (key ("CircularLayout.minDistSibling")
-	       .type ("length")
-	       .alias_function ("function (o) return o['sibling pre sep'] + o['sibling post sep'] end")
-	       .documentation_in ("pgf.gd.doc.ogdf.layered.CircularLayout"));
+    declare_options<CircularLayout_script> (s, "pgf.gd.doc.ogdf.misclayout.CircularLayout");
   }
 };
 
@@ -10,16 +10,26 @@ struct PlanarizationLayout_script :
     using namespace ogdf;
     PlanarizationLayout layout;
     
-    parameters->configure_option ("PlanarizationLayout.preprocessCliques",
-				  &PlanarizationLayout::preprocessCliques, layout);
-    parameters->configure_option ("PlanarizationLayout.minCliqueSize",
-				  &PlanarizationLayout::minCliqueSize, layout);
+    parameters->configure_options<PlanarizationLayout_script> (layout);
 
     // .. TODO: configure modules
     
     layout.call (graph_attributes);
   }
   
+  template <class Visitor>
+  static void options (Visitor& v) {
+    using namespace scripting;
+    using namespace ogdf;
+
+    v (describe ("PlanarizationLayout.preprocessCliques", &PlanarizationLayout::preprocessCliques)
+       .type ("boolean")
+       .initial ("false"));
+    v (describe ("PlanarizationLayout.minCliqueSize", &PlanarizationLayout::minCliqueSize)
+       .type ("number")
+       .initial ("10"));
+  }
+  
   void declare (scripting::script s) {
     using namespace scripting;
     using namespace ogdf;
@@ -29,15 +39,7 @@ struct PlanarizationLayout_script :
 	       .algorithm (this)
 	       .documentation_in ("pgf.gd.doc.ogdf.planarity.PlanarizationLayout"));
 
-    s.declare (key ("PlanarizationLayout.preprocessCliques")
-	       .type ("boolean")
-	       .initial ("false")
-	       .documentation_in ("pgf.gd.doc.ogdf.planarity.PlanarizationLayout"));
-    
-    s.declare (key ("PlanarizationLayout.minCliqueSize")
-	       .type ("number") 
-	       .initial ("10")
-	       .documentation_in ("pgf.gd.doc.ogdf.planarity.PlanarizationLayout"));
+    declare_options<PlanarizationLayout_script> (s, "pgf.gd.doc.ogdf.planarity.PlanarizationLayout");
   }
   
 };
@@ -0,0 +1,155 @@
+-- Support for the regression tests of algorithms written in C. The
+-- tests use the demo layouts of the C library
+-- pgf_gd_examples_c_SimpleDetachedDemoC, which must have been built
+-- and installed. After each layout, the positions of the vertices and
+-- the paths of the edges are written to the log.
+
+local InterfaceCore         = require "pgf.gd.interface.InterfaceCore"
+local InterfaceToAlgorithms = require "pgf.gd.interface.InterfaceToAlgorithms"
+local InterfaceToDisplay    = require "pgf.gd.interface.InterfaceToDisplay"
+local Coordinate            = require "pgf.gd.model.Coordinate"
+local Path                  = require "pgf.gd.model.Path"
+local lib                   = require "pgf.gd.lib"
+
+local declare = InterfaceToAlgorithms.declare
+
+-- helper
+local function typeout(...)
+  texio.write_nl(17, "Gd Lua layer Info: " .. string.format(...))
+end
+
+local function number(x)
+  local s = string.format("%.3f", x)
+  return s == "-0.000" and "0.000" or s
+end
+
+local function point(c)
+  return "(" .. number(c.x) .. "," .. number(c.y) .. ")"
+end
+
+-- The syntactic edges in the order in which the C interface passes them
+local function syntactic_edges(algorithm)
+  local edges = {}
+  for _,a in ipairs(algorithm.ugraph.arcs) do
+    local b = algorithm.layout_graph:arc(a.tail,a.head)
+    if b then
+      lib.icopy(b.syntactic_edges, edges)
+    end
+  end
+  return edges
+end
+
+
+declare {
+  key = "stale edge paths",
+  algorithm = {
+    run = function (self)
+      for _,e in ipairs(syntactic_edges(self)) do
+        e.path = Path.new { "moveto", Coordinate.new(99, 99), "lineto", Coordinate.new(98, 98) }
+      end
+    end
+  },
+  phase = "preprocessing",
+  summary = "Gives all edges a path that the algorithm must replace."
+}
+
+declare {
+  key = "stale vertex slots",
+  algorithm = {
+    run = function (self)
+      -- Reverse the vertices of the ugraph, but not its slots table,
+      -- and remove the slot of one vertex
+      local vertices = self.ugraph.vertices
+      local n = #vertices
+      for i=1,math.floor(n/2) do
+        vertices[i], vertices[n+1-i] = vertices[n+1-i], vertices[i]
+      end
+      self.ugraph.slots[vertices[1]] = nil
+    end
+  },
+  phase = "preprocessing",
+  summary = "Changes the vertex array of the ugraph behind its back."
+}
+
+-- The size of the component that was preprocessed last. Like random
+-- numbers, which are reseeded for each component, this is only right
+-- for the postprocessor if each component is finished right after it
+-- has been prepared.
+local component_size = 0
+
+declare {
+  key = "remember component size",
+  algorithm = {
+    run = function (self)
+      component_size = #self.ugraph.vertices
+    end
+  },
+  phase = "preprocessing",
+  summary = "Remembers the number of vertices of the component."
+}
+
+declare {
+  key = "shift by component size",
+  algorithm = {
+    run = function (self)
+      for _,e in ipairs(syntactic_edges(self)) do
+        e.path:shift(0, component_size)
+      end
+    end
+  },
+  phase = "postprocessing",
+  summary = "Moves the edge paths up by the remembered component size."
+}
+
+
+-- Count the runs on all components at once. When collect_garbage is
+-- set, all garbage is collected before each of them, so that the
+-- algorithm only finds the strings that have been copied for it.
+
+pgfgdtest = { collect_garbage = false }
+
+local parallel_runs = 0
+local detached_class = InterfaceCore.algorithm_classes["fast simple detached demo layout"]
+local runPrepared = assert(detached_class.runPrepared)
+
+function detached_class.runPrepared(...)
+  parallel_runs = parallel_runs + 1
+  if pgfgdtest.collect_garbage then
+    collectgarbage("collect")
+  end
+  return runPrepared(...)
+end
+
+-- Returns the number of runs on all components at once since the
+-- last call.
+function pgfgdtest.parallel_runs()
+  local result = parallel_runs
+  parallel_runs = 0
+  return result
+end
+
+
+-- Log the drawing before it is rendered
+
+local renderGraph = assert(InterfaceToDisplay.renderGraph)
+function InterfaceToDisplay.renderGraph(...)
+  local syntactic_digraph = InterfaceCore.topScope().syntactic_digraph
+
+  for _,v in ipairs(syntactic_digraph.vertices) do
+    typeout("Vertex '%s' at %s", v.name, point(v.pos))
+  end
+
+  for _,a in ipairs(syntactic_digraph.arcs) do
+    for _,e in ipairs(a.syntactic_edges) do
+      local p = e.path:clone()
+      p:makeRigid()
+      local s = {}
+      for i=1,#p do
+        s[i] = type(p[i]) == "table" and point(p[i]) or p[i]
+      end
+      typeout("Edge '%s' from '%s' to '%s': %s", e.direction, e.tail.name, e.head.name, table.concat(s, " "))
+    end
+  end
+
+  return renderGraph(...)
+end
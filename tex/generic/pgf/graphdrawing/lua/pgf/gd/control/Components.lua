@@ -142,3 +142,23 @@ declare {
 
 
 
+
+---
+
+declare {
+  key = "parallel components",
+  type = "boolean",
+
+  summary = [["
+    When an algorithm that is implemented in C and runs detached from
+    Lua is applied to the components of a graph individually, this key
+    causes the algorithm to be run on all components at the same time,
+    each in its own thread. The components are prepared and the
+    results are written back one after the other, in the order of the
+    components, so the drawing does not change. The key has no effect
+    on algorithms implemented in Lua and when edge routing or
+    postprocessing algorithms are used. Where the C library has been
+    compiled without support for threads, the components are
+    processed one after the other.
+  "]],
+}
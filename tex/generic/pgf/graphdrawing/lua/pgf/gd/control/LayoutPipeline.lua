@@ -164,6 +164,58 @@ end
 
 
 
+--
+-- Runs the edge routers and postprocessors on a component whose
+-- layout has been computed by the algorithm and then syncs and
+-- orients the component.
+--
+-- @param scope The graph drawing scope.
+-- @param layout The layout to which the component belongs.
+-- @param layout_graph The layout graph.
+-- @param syntactic_component The component.
+-- @param algorithm The algorithm object that was run on the component.
+--
+local function finish_component(scope, layout, layout_graph, syntactic_component, algorithm)
+
+  local digraph = algorithm.digraph
+  local ugraph = algorithm.ugraph
+
+  -- Step 2.9a: Run edge routers
+  for _,class in ipairs(layout_graph.options.algorithm_phases["edge routing stack"]) do
+    class.new{
+      digraph = digraph,
+      ugraph = ugraph,
+      scope = scope,
+      layout = layout,
+      layout_graph = layout_graph,
+      syntactic_component = syntactic_component,
+    }:run()
+  end
+
+  -- Step 2.9b: Run postprocessor
+  for _,class in ipairs(layout_graph.options.algorithm_phases["postprocessing stack"]) do
+    class.new{
+      digraph = digraph,
+      ugraph = ugraph,
+      scope = scope,
+      layout = layout,
+      layout_graph = layout_graph,
+      syntactic_component = syntactic_component,
+    }:run()
+  end
+
+  -- Step 2.10: Sync the graphs
+  digraph:sync()
+  ugraph:sync()
+  if algorithm.spanning_tree then
+    algorithm.spanning_tree:sync()
+  end
+
+  -- Step 2.11: Orient the graph
+  LayoutPipeline.orient(algorithm.rotation_info, algorithm.postconditions, syntactic_component, scope)
+end
+
+
 --
 -- This method is called by the sublayout rendering pipeline when the
 -- algorithm should be invoked for an individual graph. At this point,
@@ -199,6 +251,19 @@ function LayoutPipeline.runOnLayout(scope, algorithm_class, layout_graph, layout
     syntactic_components = { layout_copy }
   end
 
+  -- Algorithms written in C that run detached from Lua can be run on
+  -- all components at once. Since the components are then prepared
+  -- before any of them is finished, this is only done when no edge
+  -- routers and postprocessors are run: these might draw random
+  -- numbers, which must be the same as when each component is
+  -- finished right after its preparation.
+  local phases = layout_graph.options.algorithm_phases
+  local parallel = algorithm_class.runPrepared and #syntactic_components > 1
+                   and layout_graph.options['parallel components']
+                   and #phases["edge routing stack"] == 0
+                   and #phases["postprocessing stack"] == 0
+  local algorithms, prepared = {}, {}
+
   -- Step 2: For all components do:
   for i,syntactic_component in ipairs(syntactic_components) do
 
@@ -261,44 +326,33 @@ function LayoutPipeline.runOnLayout(scope, algorithm_class, layout_graph, layout
       -- Main run of the algorithm:
       if algorithm_class.old_graph_model then
         LayoutPipeline.runOldGraphModel(scope, digraph, algorithm_class, algorithm)
+      elseif parallel then
+        algorithm:prepare ()
+        prepared[#prepared+1] = algorithm
       else
         algorithm:run ()
       end
     end
 
-    -- Step 2.9a: Run edge routers
-    for _,class in ipairs(layout_graph.options.algorithm_phases["edge routing stack"]) do
-      class.new{
-        digraph = digraph,
-        ugraph = ugraph,
-        scope = scope,
-        layout = layout,
-        layout_graph = layout_graph,
-        syntactic_component = syntactic_component,
-      }:run()
+    if parallel then
+      algorithms[i] = algorithm
+    else
+      finish_component(scope, layout, layout_graph, syntactic_component, algorithm)
     end
+  end
 
-    -- Step 2.9b: Run postprocessor
-    for _,class in ipairs(layout_graph.options.algorithm_phases["postprocessing stack"]) do
-      class.new{
-        digraph = digraph,
-        ugraph = ugraph,
-        scope = scope,
-        layout = layout,
-        layout_graph = layout_graph,
-        syntactic_component = syntactic_component,
-      }:run()
-    end
+  -- Step 2a: Run the prepared algorithms concurrently and finish all
+  -- components in order:
+  if parallel then
+    algorithm_class.runPrepared(prepared)
 
-    -- Step 2.10: Sync the graphs
-    digraph:sync()
-    ugraph:sync()
-    if algorithm.spanning_tree then
-      algorithm.spanning_tree:sync()
+    for i,syntactic_component in ipairs(syntactic_components) do
+      local algorithm = algorithms[i]
+      if algorithm.c_digraph then
+        algorithm:finish()
+      end
+      finish_component(scope, layout, layout_graph, syntactic_component, algorithm)
     end
-
-    -- Step 2.11: Orient the graph
-    LayoutPipeline.orient(algorithm.rotation_info, algorithm.postconditions, syntactic_component, scope)
   end
 
   -- Step 3: Packing:
@@ -745,7 +799,7 @@ function LayoutPipeline.decompose (digraph)
   end
 
   for _,c in ipairs(components) do
-    table.sort (c.vertices, function (u,v) return u.event.index < v.event.index end)
+    c:sortVertices (function (u,v) return u.event.index < v.event.index end)
     for _,v in ipairs(c.vertices) do
       for _,a in ipairs(digraph:outgoing(v)) do
         local new_a = c:connect(a.tail, a.head)
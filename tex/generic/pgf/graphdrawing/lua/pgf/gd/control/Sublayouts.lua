@@ -432,7 +432,7 @@ function Sublayouts.layoutRecursively(scope, layout, fun)
   end
 
   -- Sort the vertices
-  table.sort(syntactic_digraph.vertices, function(u,v) return u.event.index < v.event.index end)
+  syntactic_digraph:sortVertices(function(u,v) return u.event.index < v.event.index end)
 
   -- Should we "hide" the subgraph nodes?
   local hidden_node
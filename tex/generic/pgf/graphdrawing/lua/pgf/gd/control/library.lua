@@ -121,6 +121,36 @@ declare {
 }
 
 
+---
+declare {
+  key = "gd threads",
+  type = "number",
+  initial = "0",
+
+  summary = [["
+    The number of threads that algorithms implemented in C may use to
+    compute a layout, for instance, when the |parallel components|
+    key is set. The default, |0|, means that one thread per processor
+    is used; use |1| to compute everything in the main thread.
+  "]]
+}
+
+
+---
+declare {
+  key = "gd timing",
+  type = "boolean",
+
+  summary = [["
+    When set, algorithms implemented in C measure how long it takes
+    to translate the graph for them, to run them, and to write back
+    their results. The times are written to the log file together
+    with the size of the graph and are also available in the array
+    |InterfaceToC.timings|.
+  "]]
+}
+
+
 ---
 declare {
   key = "weight",
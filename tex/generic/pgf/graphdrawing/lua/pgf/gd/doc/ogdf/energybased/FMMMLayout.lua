@@ -93,6 +93,22 @@ example
 
 
 
+--------------------------------------------------------------------------------
+key           "FMMMLayout.keepPositions"
+summary       "Start from the current positions of the nodes."
+
+documentation
+[[
+Normally, the |FMMMLayout| starts from a random placement of the
+nodes. When this key is set, the initial placement keeps the positions
+that the nodes have when the algorithm is invoked, for instance the
+positions computed by an algorithm run earlier on the same graph. The
+|FMMMLayout| then improves this layout.
+]]
+--------------------------------------------------------------------------------
+
+
+
 --------------------------------------------------------------------------------
 key           "FMMMLayout.unitEdgeLength"
 summary       "The ``ideal'' padding between two nodes."
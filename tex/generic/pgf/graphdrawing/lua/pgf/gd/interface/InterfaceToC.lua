@@ -22,6 +22,60 @@ local InterfaceToC = {}
 local lib = require "pgf.gd.lib"
 
 
+---
+-- When the |gd timing| key is set for a graph, the C code of an
+-- algorithm reports how long the phases of each of its runs took. The
+-- reports are collected in this array, one per run. Each is a table
+-- that maps the names of the phases (like |construct_digraph|,
+-- |algorithm| and |sync_digraph|, see |pgfgd_add_phase_time| in
+-- |InterfaceFromC.h|) to the times in seconds and also has the fields
+-- |key| (the algorithm key), |vertices|, |edges|, and |path points|
+-- (the number of coordinates on the edge paths written back). Each
+-- report is also written to the log file.
+
+InterfaceToC.timings = {}
+
+local phase_order = { "construct_digraph", "bridge", "run", "unbridge", "algorithm", "sync_digraph" }
+
+local function log_timing (timing)
+  local phases, known = {}, {}
+  for _,p in ipairs(phase_order) do
+    known[p] = true
+    if timing[p] then
+      phases[#phases+1] = p
+    end
+  end
+  local others = {}
+  for p,v in pairs(timing) do
+    if type(v) == "number" and not known[p] and p ~= "vertices" and p ~= "edges" and p ~= "path points" then
+      others[#others+1] = p
+    end
+  end
+  table.sort(others)
+  lib.icopy(others, phases)
+
+  local s = {}
+  for i,p in ipairs(phases) do
+    s[i] = string.format("%s %.3fms", p, timing[p]*1000)
+  end
+  texio.write_nl("log", string.format("Graph drawing timing of %s (%d vertices, %d edges, %d path points): %s",
+                                      timing.key, timing.vertices, timing.edges, timing["path points"],
+                                      table.concat(s, ", ")))
+end
+
+local function report_timing (key, algorithm)
+  local timing = algorithm.timing
+  if timing then
+    timing.key = key
+    InterfaceToC.timings[#InterfaceToC.timings+1] = timing
+    if texio then
+      log_timing(timing)
+    end
+    algorithm.timing = nil
+  end
+end
+
+
 ---
 -- This function is called by |declare| for ``algorithm
 -- keys'' where the algorithm is not written in Lua, but rather in the
@@ -38,37 +92,78 @@ local lib = require "pgf.gd.lib"
 --   \item The to-be-laid out digraph. This will not be the whole layout
 --     graph (syntactic digraph) if preprocessing like decomposition into
 --     connected components is used.
---   \item An array of the digraph's vertices, but with the table part
---     hashing vertex objects to their indices in the array part.
---   \item An array of the syntactic edges of the digraph. Like the
---     array, the table part will hash back the indices of the edge objects.
+--   \item The |vertices| array of the algorithm's |ugraph|. The
+--     indices of the vertex objects can be looked up in the |slots|
+--     table of the |ugraph|, which is maintained by the |Digraph|
+--     class, so no lookup table needs to be built here.
+--   \item An array of the syntactic edges of the digraph. These are
+--     the syntactic edges of the arcs of the layout graph, collected in
+--     the order of the |ugraph|'s arcs; the C code finds the position
+--     of the edges of an arc using the arc's |slot|.
 --   \item The algorithm object.
 -- \end{enumerate}
 --
+-- For algorithms that run detached from Lua, the table's
+-- |run_detached_in_c| field is also set. In this case, the algorithm
+-- class additionally gets the methods |prepare| and |finish| and the
+-- function |runPrepared|: Instead of calling |run| for the algorithm
+-- objects of several components, you can call |prepare| for each of
+-- them, then |runPrepared| once with an array of all of them, which
+-- runs the C function on all components concurrently, and finally
+-- |finish| for each of them, which writes back the results.
+--
 -- @param t The table originally passed to |declare|.
 
 function InterfaceToC.declare_algorithm_written_in_c (t)
+
+  local function syntactic_edges (self)
+    local edges = {}
+    for _,a in ipairs(self.ugraph.arcs) do
+      local b = self.layout_graph:arc(a.tail,a.head)
+      if b then
+        lib.icopy(b.syntactic_edges, edges)
+      end
+    end
+    return edges
+  end
+
   t.algorithm = {
     run = function (self)
-      local back_table = lib.icopy(self.ugraph.vertices)
-      for i,v in ipairs(self.ugraph.vertices) do
-        back_table[v] = i
-      end
-      local edges = {}
-      for _,a in ipairs(self.ugraph.arcs) do
-        local b = self.layout_graph:arc(a.tail,a.head)
-        if b then
-          lib.icopy(b.syntactic_edges, edges)
-        end
-      end
-      for i=1,#edges do
-        edges[edges[i]] = i
-      end
+      local edges = syntactic_edges(self)
       collectgarbage("stop") -- Remove once Lua Link Bug is fixed
-      t.algorithm_written_in_c (self.digraph, back_table, edges, self)
+      t.algorithm_written_in_c (self.digraph, self.ugraph.vertices, edges, self)
       collectgarbage("restart") -- Remove once Lua Link Bug is fixed
+      report_timing(t.key, self)
     end
   }
+
+  if t.run_detached_in_c then
+    local algorithm = t.algorithm
+
+    function algorithm:prepare ()
+      self.c_edges = syntactic_edges(self)
+      collectgarbage("stop") -- Remove once Lua Link Bug is fixed
+      self.c_digraph, self.c_anchors =
+        t.algorithm_written_in_c (self.digraph, self.ugraph.vertices, self.c_edges, self, true)
+      collectgarbage("restart") -- Remove once Lua Link Bug is fixed
+    end
+
+    function algorithm.runPrepared (algorithms)
+      local digraphs = {}
+      for i,a in ipairs(algorithms) do
+        digraphs[i] = a.c_digraph
+      end
+      t.run_detached_in_c (digraphs)
+    end
+
+    function algorithm:finish ()
+      collectgarbage("stop") -- Remove once Lua Link Bug is fixed
+      t.algorithm_written_in_c (self.digraph, self.ugraph.vertices, self.c_edges, self, self.c_digraph, self.c_anchors)
+      collectgarbage("restart") -- Remove once Lua Link Bug is fixed
+      self.c_edges, self.c_digraph, self.c_anchors = nil, nil, nil
+      report_timing(t.key, self)
+    end
+  end
 end
 
 
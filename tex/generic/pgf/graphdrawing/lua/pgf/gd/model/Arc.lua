@@ -65,6 +65,8 @@
 -- @field tail The tail vertex of the arc.
 -- @field head The head vertex of the arc. May be the same as the tail
 -- in case of a loop.
+-- @field slot A number assigned to the arc by the |connect| method of
+-- its digraph, see the |arc_slots| field of |Digraph|.
 -- @field path If non-nil, the path of the arc. See the description
 -- above.
 -- @field generated_options If non-nil, some options to be passed back
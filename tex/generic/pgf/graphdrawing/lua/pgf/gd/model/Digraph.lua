@@ -176,6 +176,20 @@
 --   sequence takes time $O(k)$, provided you do not access the |arcs|
 --   field between calls.
 --
+-- @field slots This table maps each vertex of the digraph to its
+--   position in the |vertices| array, which we call the vertex's
+--   \emph{slot} in the digraph. Slots are assigned by |add|, kept up
+--   to date by |remove| and |sortVertices|, and allow code (especially
+--   the interface to C) to get the index of a vertex in time $O(1)$
+--   without building a lookup table of its own. Like |vertices|, you
+--   may not modify this table.
+--
+-- @field arc_slots The number of arcs that have been created by
+--   |connect| so far. Each arc stores its number in its |slot| field,
+--   so the slots of the arcs of a digraph are distinct integers
+--   between 1 and |arc_slots|, which do not change when other arcs are
+--   removed.
+--
 -- @field syntactic_digraph is a reference to the syntactic digraph
 --    from which this graph stems ultimately. This may be a cyclic
 --    reference to the graph itself.
@@ -272,7 +286,9 @@ function Digraph.new(initial)
 
   local vertices = digraph.vertices
   digraph.vertices = {}
+  digraph.slots = {}
   digraph.arcs = {}
+  digraph.arc_slots = 0
 
   if vertices then
     digraph:add(vertices)
@@ -289,11 +305,13 @@ end
 --
 function Digraph:add(array)
   local vertices = self.vertices
+  local slots = self.slots
   for i=1,#array do
     local v = array[i]
     if not vertices[v] then
       vertices[v] = true
       vertices[#vertices + 1] = v
+      slots[v] = #vertices
       v.incomings[self] = {}
       v.outgoings[self] = {}
     end
@@ -329,6 +347,35 @@ function Digraph:remove(array)
   end
 
   LookupTable.remove(self.vertices, array)
+
+  -- Update the slots of the remaining vertices
+  local slots = self.slots
+  for i=1,#array do
+    slots[array[i]] = nil
+  end
+  for i=1,#vertices do
+    slots[vertices[i]] = i
+  end
+end
+
+
+
+--- Sorts the vertices array of a digraph. Since you may not modify
+-- the |vertices| array directly, use this method instead of calling
+-- |table.sort| on it; it will also update the slots of the vertices.
+--
+-- This operation takes time $O(|\verb!self.vertices!| \log |\verb!self.vertices!|)$.
+--
+-- @param f A comparison function that is passed to |table.sort|
+--
+function Digraph:sortVertices(f)
+  local vertices = self.vertices
+  table.sort(vertices, f)
+
+  local slots = self.slots
+  for i=1,#vertices do
+    slots[vertices[i]] = i
+  end
 end
 
 
@@ -497,9 +544,12 @@ function Digraph:connect(s, t)
 
   if not arc then
     -- Ok, create and insert new arc object
+    local slot = self.arc_slots + 1
+    self.arc_slots = slot
     arc = {
       tail = s,
       head = t,
+      slot = slot,
       option_cache = {},
       syntactic_digraph = self.syntactic_digraph,
       syntactic_edges = {}